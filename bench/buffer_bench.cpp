@@ -0,0 +1,199 @@
+/*
+ * @buffer_bench.cpp
+ * -----------------
+ * Buffer 微基准：对比普通整数读写位置与原先 std::atomic<size_t> 读写位置的吞吐。
+ *
+ * - Write_to_Buffer + Update_ReadPos：按响应头的写法追加若干小段，再整体消费（对应生成并写出一个响应）
+ * - Update_ReadPos：逐段推进读位置（对应解析器按行消费请求）
+ * - Get_Data：从 socketpair 读入 4KB 数据再消费（包含系统调用）
+ * - Init_Buffer：缓冲区曾经增长到 256KB 后，每个 keep-alive 响应之后的一次重置（原先会清零整个容量）
+ * - 空闲连接：N 个连接各处理一个请求后进入空闲，统计它们仍占用的缓冲区内存（原先每个缓冲区常驻，现在空闲时归还 BufferPool）
+ *
+ * 用法：
+ *   make bench && ./bin/buffer_bench [轮数] [空闲连接数]
+ */
+#include"buffer.h"
+#include<vector>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<sys/socket.h>
+
+//原先的Buffer（读写位置为std::atomic<size_t>），仅保留基准用到的接口
+class LegacyBuffer{
+    private:
+    std::vector<char>buffer_;
+    std::atomic<size_t>ReadPos_;
+    std::atomic<size_t>WritePos_;
+    char* BeginPtr_(){
+        return &*buffer_.begin();
+    }
+    void We_Should_Be_Enough_(size_t Length_We_Need){
+        if(ReadPos_+How_Many_Bytes_Can_We_Write()<Length_We_Need){
+            buffer_.resize(WritePos_+Length_We_Need+1);
+        }else{
+            size_t T_Not_Read=How_Many_Bytes_We_Need_Read();
+            std::copy(BeginPtr_()+ReadPos_,BeginPtr_()+WritePos_,BeginPtr_());
+            WritePos_=T_Not_Read;
+            ReadPos_=0;
+        }
+    }
+    public:
+    LegacyBuffer(int InitBufferSpace=1024):buffer_(InitBufferSpace),ReadPos_(0),WritePos_(0){}
+    void Init_Buffer(){
+        std::memset(BeginPtr_(),0,buffer_.size());
+        ReadPos_=0;
+        WritePos_=0;
+    }
+    //原先的Buffer没有归还存储的接口
+    bool Release(){
+        Init_Buffer();
+        return false;
+    }
+    size_t Capacity() const{
+        return buffer_.size();
+    }
+    size_t How_Many_Bytes_Can_We_Write() const{
+        return buffer_.size()-WritePos_;
+    }
+    size_t How_Many_Bytes_We_Need_Read() const{
+        return WritePos_-ReadPos_;
+    }
+    void Update_ReadPos(size_t Step_Length){
+        assert(Step_Length<=How_Many_Bytes_We_Need_Read());
+        ReadPos_=ReadPos_+Step_Length;
+    }
+    void Write_to_Buffer(const char* Data,size_t Data_Length){
+        assert(Data);
+        if(How_Many_Bytes_Can_We_Write()<Data_Length){
+            We_Should_Be_Enough_(Data_Length);
+        }
+        std::copy(Data,Data+Data_Length,BeginPtr_()+WritePos_);
+        WritePos_=WritePos_+Data_Length;
+    }
+    ssize_t Get_Data(int FileD,int* Errono){
+        char Buffer_Temple[8192];
+        iovec Ready_for_Input[2];
+        const size_t Write_Space_We_Can_Use=How_Many_Bytes_Can_We_Write();
+        Ready_for_Input[0].iov_base=BeginPtr_()+WritePos_;
+        Ready_for_Input[0].iov_len=Write_Space_We_Can_Use;
+        Ready_for_Input[1].iov_base=Buffer_Temple;
+        Ready_for_Input[1].iov_len=sizeof(Buffer_Temple);
+        const ssize_t Length=readv(FileD,Ready_for_Input,2);
+        if(Length<0){
+            *Errono=errno;
+            return Length;
+        }else if(static_cast<size_t>(Length)<=Write_Space_We_Can_Use){
+            WritePos_=WritePos_+Length;
+        }else{
+            WritePos_=buffer_.size();
+            Write_to_Buffer(Buffer_Temple,Length-Write_Space_We_Can_Use);
+        }
+        return Length;
+    }
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point begin){
+    return std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-begin).count();
+}
+
+template<typename Buf>
+static void run(const char* name,int rounds,int fds[2]){
+    static const char* pieces[]={"HTTP/1.1 200 OK\r\n","Connection:keep-alive\r\n","Content-type:text/html\r\n",
+                                 "Content-Length:3148\r\n\r\n"};
+    size_t sink=0;
+    Buf buffer;
+    //追加响应头的各段，再整体消费
+    auto begin=std::chrono::steady_clock::now();
+    for(int i=0;i<rounds;++i){
+        for(const char* piece:pieces){
+            buffer.Write_to_Buffer(piece,strlen(piece));
+        }
+        sink+=buffer.How_Many_Bytes_We_Need_Read();
+        buffer.Update_ReadPos(buffer.How_Many_Bytes_We_Need_Read());
+    }
+    double append=elapsed_ns(begin)/rounds;
+    //逐段推进读位置
+    static char block[4096];
+    memset(block,'a',sizeof(block));
+    begin=std::chrono::steady_clock::now();
+    for(int i=0;i<rounds/16;++i){
+        buffer.Write_to_Buffer(block,sizeof(block));
+        while(buffer.How_Many_Bytes_We_Need_Read()>0){
+            buffer.Update_ReadPos(16);
+        }
+    }
+    double consume=elapsed_ns(begin)/(rounds/16*(sizeof(block)/16));
+    //从套接字读入
+    int get_rounds=rounds/16;
+    begin=std::chrono::steady_clock::now();
+    for(int i=0;i<get_rounds;++i){
+        if(write(fds[0],block,sizeof(block))!=static_cast<ssize_t>(sizeof(block))){
+            perror("write");
+            return;
+        }
+        int error=0;
+        ssize_t got=buffer.Get_Data(fds[1],&error);
+        sink+=got;
+        buffer.Update_ReadPos(buffer.How_Many_Bytes_We_Need_Read());
+    }
+    double get=elapsed_ns(begin)/get_rounds;
+    //增长到256KB后的重置
+    std::vector<char> large(256*1024,'b');
+    buffer.Write_to_Buffer(large.data(),large.size());
+    buffer.Update_ReadPos(buffer.How_Many_Bytes_We_Need_Read());
+    int reset_rounds=rounds/64;
+    begin=std::chrono::steady_clock::now();
+    for(int i=0;i<reset_rounds;++i){
+        buffer.Write_to_Buffer(pieces[0],strlen(pieces[0]));
+        buffer.Update_ReadPos(buffer.How_Many_Bytes_We_Need_Read());
+        buffer.Init_Buffer();
+    }
+    double reset=elapsed_ns(begin)/reset_rounds;
+    printf("%-16s append+consume %6.1f ns/response   Update_ReadPos %5.2f ns/call   Get_Data %7.1f ns/4KB   Init_Buffer(256KB) %8.1f ns   (%zu)\n",
+           name,append,consume,get,reset,sink);
+}
+
+//每个连接一对读写缓冲区：读入一个请求、写出一个响应头后进入空闲，统计空闲时仍占用的内存
+template<typename Buf>
+static void run_idle(const char* name,int connections){
+    static const char request[]="GET /index.html HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+    static const char response[]="HTTP/1.1 200 OK\r\nConnection:keep-alive\r\nContent-type:text/html\r\nContent-Length:3148\r\n\r\n";
+    std::vector<Buf> reads(connections);
+    std::vector<Buf> writes(connections);
+    auto begin=std::chrono::steady_clock::now();
+    for(int i=0;i<connections;++i){
+        reads[i].Write_to_Buffer(request,sizeof(request)-1);
+        reads[i].Update_ReadPos(reads[i].How_Many_Bytes_We_Need_Read());
+        writes[i].Write_to_Buffer(response,sizeof(response)-1);
+        writes[i].Update_ReadPos(writes[i].How_Many_Bytes_We_Need_Read());
+        reads[i].Release();
+        writes[i].Release();
+    }
+    double per=elapsed_ns(begin)/connections;
+    size_t held=0;
+    for(int i=0;i<connections;++i){
+        held+=reads[i].Capacity()+writes[i].Capacity();
+    }
+    printf("%-16s %d idle connections hold %8zu KB of buffers   %6.1f ns/request\n",name,connections,held/1024,per);
+}
+
+int main(int argc,char* argv[]){
+    int rounds=argc>1?atoi(argv[1]):4000000;
+    int connections=argc>2?atoi(argv[2]):50000;
+    int fds[2];
+    if(socketpair(AF_UNIX,SOCK_STREAM,0,fds)<0){
+        perror("socketpair");
+        return 1;
+    }
+    printf("%d rounds\n",rounds);
+    run<LegacyBuffer>("atomic positions",rounds,fds);
+    run<Buffer>("plain positions",rounds,fds);
+    run_idle<LegacyBuffer>("resident buffers",connections);
+    run_idle<Buffer>("pooled buffers",connections);
+    BufferPool::Stats stats=BufferPool::Local_Stats();
+    printf("pool: %zu blocks (%zu KB) cached, %zu hits, %zu misses\n",
+           stats.Cached_Blocks,stats.Cached_Bytes/1024,stats.Hits,stats.Misses);
+    return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * @loadgen.cpp
+ * ------------
+ * 流水线 keep-alive 压测工具：若干长连接，每个连接一次写出 depth 个 GET 请求，
+ * 收齐 depth 个响应后再发下一批，统计每秒请求数、吞吐与每批的往返延迟分位数。
+ * depth 为 1 时即普通的 keep-alive 压测，可与 depth>1 对比流水线的收益。
+ *
+ * 响应按 Content-Length 划分，不区分状态码（404 也计为一个完成的响应）。
+ *
+ * 给出服务器进程号时，压测期间用 perf_event_open 在服务器的每个线程上计数 raw_syscalls:sys_enter
+ * 跟踪点，报告服务器的系统调用总数与每个请求的系统调用数，用于比较 epoll 与 io_uring 后端。
+ * 需要挂载 tracefs（/sys/kernel/tracing 或 /sys/kernel/debug/tracing）并有权限观察该进程。
+ *
+ * 用法：
+ *   make bench && ./bin/loadgen [端口] [连接数] [流水线深度] [秒数] [路径] [服务器进程号]
+ *   例如：./bin/loadgen 8080 64 16 10 /index.html $(pidof tiny_web_server_2025)
+ */
+#include<sys/epoll.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<errno.h>
+#include<strings.h>
+#include<dirent.h>
+#include<algorithm>
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<string>
+#include<vector>
+
+using Clock=std::chrono::steady_clock;
+
+//一个压测连接
+struct Client{
+    int fd=-1;
+    //一批请求（depth个）
+    std::string request;
+    //已写出的请求字节数
+    size_t sent=0;
+    //收到但尚未划分成响应的数据
+    std::string input;
+    //本批已收齐的响应数
+    int received=0;
+    Clock::time_point batch_begin;
+};
+
+static int connect_to(int port){
+    int fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK,0);
+    if(fd<0){
+        return -1;
+    }
+    int one=1;
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+    sockaddr_in addr={};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(port);
+    addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    if(connect(fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))<0&&errno!=EINPROGRESS){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//从input头部划分出完整的响应，返回个数；出错（没有Content-Length）时返回-1
+static int take_responses(std::string& input,size_t* bytes){
+    int count=0;
+    size_t pos=0;
+    for(;;){
+        size_t end=input.find("\r\n\r\n",pos);
+        if(end==std::string::npos){
+            break;
+        }
+        size_t length=0;
+        bool found=false;
+        for(size_t line=pos;line<end;){
+            size_t next=input.find("\r\n",line);
+            if(next==std::string::npos||next>end){
+                next=end;
+            }
+            if(next-line>15&&strncasecmp(input.data()+line,"Content-Length:",15)==0){
+                length=strtoull(input.data()+line+15,nullptr,10);
+                found=true;
+            }
+            line=next+2;
+        }
+        if(!found){
+            return -1;
+        }
+        size_t total=end+4-pos+length;
+        if(input.size()-pos<total){
+            break;
+        }
+        *bytes+=total;
+        pos+=total;
+        ++count;
+    }
+    input.erase(0,pos);
+    return count;
+}
+
+//raw_syscalls:sys_enter跟踪点的id，没有挂载tracefs时返回-1
+static long syscall_tracepoint(){
+    const char* paths[]={"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                         "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+    for(const char* path:paths){
+        FILE* file=fopen(path,"r");
+        if(file==nullptr){
+            continue;
+        }
+        long id=-1;
+        if(fscanf(file,"%ld",&id)!=1){
+            id=-1;
+        }
+        fclose(file);
+        return id;
+    }
+    return -1;
+}
+
+//在进程Pid的每个线程上打开系统调用计数器（先不启用），失败时返回空
+static std::vector<int> open_syscall_counters(int Pid){
+    std::vector<int> counters;
+    long id=syscall_tracepoint();
+    if(id<0){
+        fprintf(stderr,"raw_syscalls:sys_enter not found, mount tracefs to count syscalls\n");
+        return counters;
+    }
+    std::string task="/proc/"+std::to_string(Pid)+"/task";
+    DIR* dir=opendir(task.c_str());
+    if(dir==nullptr){
+        perror("opendir");
+        return counters;
+    }
+    while(dirent* entry=readdir(dir)){
+        if(entry->d_name[0]=='.'){
+            continue;
+        }
+        perf_event_attr attr={};
+        attr.size=sizeof(attr);
+        attr.type=PERF_TYPE_TRACEPOINT;
+        attr.config=id;
+        attr.disabled=1;
+        attr.inherit=1;
+        int fd=syscall(SYS_perf_event_open,&attr,atoi(entry->d_name),-1,-1,0);
+        if(fd<0){
+            perror("perf_event_open");
+            for(int counter:counters){
+                close(counter);
+            }
+            counters.clear();
+            break;
+        }
+        counters.push_back(fd);
+    }
+    closedir(dir);
+    return counters;
+}
+
+//写出本批请求的剩余部分，出错时返回false
+static bool flush(Client& client){
+    while(client.sent<client.request.size()){
+        ssize_t n=send(client.fd,client.request.data()+client.sent,client.request.size()-client.sent,MSG_NOSIGNAL);
+        if(n<0){
+            return errno==EAGAIN;
+        }
+        client.sent+=n;
+    }
+    return true;
+}
+
+int main(int argc,char* argv[]){
+    int port=argc>1?atoi(argv[1]):8080;
+    int connections=argc>2?atoi(argv[2]):64;
+    int depth=argc>3?atoi(argv[3]):16;
+    int seconds=argc>4?atoi(argv[4]):10;
+    std::string path=argc>5?argv[5]:"/index.html";
+    int server_pid=argc>6?atoi(argv[6]):0;
+    if(connections<=0||depth<=0||seconds<=0){
+        fprintf(stderr,"usage: %s [port] [connections] [depth] [seconds] [path] [server pid]\n",argv[0]);
+        return 1;
+    }
+
+    std::string one="GET "+path+" HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+    std::string batch;
+    for(int i=0;i<depth;++i){
+        batch+=one;
+    }
+
+    int epfd=epoll_create1(0);
+    std::vector<Client> clients(connections);
+    for(int i=0;i<connections;++i){
+        Client& client=clients[i];
+        client.fd=connect_to(port);
+        if(client.fd<0){
+            perror("connect");
+            return 1;
+        }
+        client.request=batch;
+        client.batch_begin=Clock::now();
+        epoll_event event={};
+        event.events=EPOLLIN|EPOLLOUT|EPOLLET;
+        event.data.u32=i;
+        epoll_ctl(epfd,EPOLL_CTL_ADD,client.fd,&event);
+    }
+
+    size_t responses=0,bytes=0,errors=0;
+    std::vector<double> latencies;
+    std::vector<epoll_event> events(connections);
+    char chunk[65536];
+    std::vector<int> counters;
+    if(server_pid>0){
+        counters=open_syscall_counters(server_pid);
+    }
+    for(int counter:counters){
+        ioctl(counter,PERF_EVENT_IOC_RESET,0);
+        ioctl(counter,PERF_EVENT_IOC_ENABLE,0);
+    }
+    Clock::time_point begin=Clock::now();
+    Clock::time_point deadline=begin+std::chrono::seconds(seconds);
+    int alive=connections;
+    while(alive>0&&Clock::now()<deadline){
+        int n=epoll_wait(epfd,events.data(),connections,100);
+        for(int e=0;e<n;++e){
+            Client& client=clients[events[e].data.u32];
+            if(client.fd<0){
+                continue;
+            }
+            bool ok=true;
+            if(events[e].events&EPOLLOUT){
+                ok=flush(client);
+            }
+            while(ok&&(events[e].events&(EPOLLIN|EPOLLHUP|EPOLLERR))){
+                ssize_t got=recv(client.fd,chunk,sizeof(chunk),0);
+                if(got<0&&errno==EAGAIN){
+                    break;
+                }
+                if(got<=0){
+                    ok=false;
+                    break;
+                }
+                client.input.append(chunk,got);
+                int done=take_responses(client.input,&bytes);
+                if(done<0){
+                    ok=false;
+                    break;
+                }
+                client.received+=done;
+                responses+=done;
+                if(client.received>=depth){
+                    //收齐一批，发下一批
+                    Clock::time_point now=Clock::now();
+                    latencies.push_back(std::chrono::duration<double,std::micro>(now-client.batch_begin).count());
+                    client.batch_begin=now;
+                    client.received=0;
+                    client.sent=0;
+                    ok=flush(client);
+                }
+            }
+            if(!ok){
+                ++errors;
+                --alive;
+                close(client.fd);
+                client.fd=-1;
+            }
+        }
+    }
+    double elapsed=std::chrono::duration<double>(Clock::now()-begin).count();
+    uint64_t syscalls=0;
+    for(int counter:counters){
+        ioctl(counter,PERF_EVENT_IOC_DISABLE,0);
+        uint64_t value=0;
+        if(read(counter,&value,sizeof(value))==sizeof(value)){
+            syscalls+=value;
+        }
+        close(counter);
+    }
+    for(Client& client:clients){
+        if(client.fd>=0){
+            close(client.fd);
+        }
+    }
+    close(epfd);
+
+    std::sort(latencies.begin(),latencies.end());
+    auto percentile=[&](double p){
+        return latencies.empty()?0.0:latencies[std::min(latencies.size()-1,static_cast<size_t>(p*latencies.size()))];
+    };
+    printf("%d connections, depth %d, %.1fs, path %s\n",connections,depth,elapsed,path.c_str());
+    printf("requests/s %.0f   MB/s %.1f   responses %zu   closed early %zu\n",
+           responses/elapsed,bytes/elapsed/1e6,responses,errors);
+    printf("batch latency p50 %.0fus  p99 %.0fus  max %.0fus\n",percentile(0.5),percentile(0.99),
+           latencies.empty()?0.0:latencies.back());
+    if(!counters.empty()){
+        printf("server syscalls %llu   syscalls/request %.2f   (%zu threads)\n",
+               static_cast<unsigned long long>(syscalls),responses?static_cast<double>(syscalls)/responses:0.0,
+               counters.size());
+    }
+    return errors>0&&responses==0?1:0;
+}
@@ -0,0 +1,117 @@
+/*
+ * @mime_bench.cpp
+ * ---------------
+ * MIME 类型查找微基准：对比原先的 substr + std::unordered_map<std::string,std::string> 查找
+ * 与编译期生成的完美哈希表 MimeTable（返回预先生成的 Content-Type 响应头行的视图）。
+ *
+ * - unordered_map：每次查找分配一个后缀字符串（短字符串优化时不分配）、计算 std::hash、探测桶链，
+ *   并复制出一个 std::string 返回
+ * - MimeTable：两次短哈希、一次比较，返回 std::string_view，不分配内存
+ * - 运行时生成的 MimeTable：与 config.json 的 mime_types 相同的路径，表较大时查找开销不变
+ * 路径混合命中（html、css、js、png 等）与未命中（没有后缀、未知后缀）。
+ *
+ * 用法：
+ *   make bench && ./bin/mime_bench [查找次数]
+ */
+#include"http_tables.h"
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<iterator>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+static double elapsed_ns(std::chrono::steady_clock::time_point begin){
+    return std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-begin).count();
+}
+
+static constexpr MimeTable::Entry TYPES[]={
+    { ".html", "Content-Type: text/html\r\n" },        { ".xml", "Content-Type: text/xml\r\n" },
+    { ".xhtml", "Content-Type: application/xhtml+xml\r\n" }, { ".txt", "Content-Type: text/plain\r\n" },
+    { ".rtf", "Content-Type: application/rtf\r\n" },   { ".pdf", "Content-Type: application/pdf\r\n" },
+    { ".word", "Content-Type: application/msword\r\n" }, { ".png", "Content-Type: image/png\r\n" },
+    { ".gif", "Content-Type: image/gif\r\n" },         { ".jpg", "Content-Type: image/jpeg\r\n" },
+    { ".jpeg", "Content-Type: image/jpeg\r\n" },       { ".au", "Content-Type: audio/basic\r\n" },
+    { ".mpeg", "Content-Type: video/mpeg\r\n" },       { ".mpg", "Content-Type: video/mpeg\r\n" },
+    { ".avi", "Content-Type: video/x-msvideo\r\n" },   { ".gz", "Content-Type: application/x-gzip\r\n" },
+    { ".tar", "Content-Type: application/x-tar\r\n" }, { ".css", "Content-Type: text/css\r\n" },
+    { ".js", "Content-Type: text/javascript\r\n" },
+};
+static constexpr MimeTable TABLE(TYPES,std::size(TYPES));
+static_assert(TABLE.Valid());
+
+//原先的做法：find_last_of、substr与unordered_map查找，返回std::string
+static std::string old_type(const std::unordered_map<std::string,std::string>& Map,const std::string& Path){
+    std::string::size_type idx=Path.find_last_of('.');
+    if(idx==std::string::npos){
+        return "text/plain";
+    }
+    std::string suffix=Path.substr(idx);
+    auto it=Map.find(suffix);
+    return it!=Map.end()?it->second:"text/plain";
+}
+
+static std::string_view new_type(const MimeTable& Table,std::string_view Path){
+    size_t idx=Path.size();
+    while(idx>0&&Path[idx-1]!='.'&&Path[idx-1]!='/'){
+        --idx;
+    }
+    if(idx==0||Path[idx-1]!='.'){
+        return "text/plain";
+    }
+    const MimeTable::Entry* entry=Table.Find(Path.substr(idx-1));
+    return entry?entry->Type():"text/plain";
+}
+
+int main(int argc,char* argv[]){
+    long lookups=argc>1?atol(argv[1]):20000000;
+    std::unordered_map<std::string,std::string> map;
+    for(const auto& entry:TYPES){
+        map.emplace(entry.Suffix,entry.Type());
+    }
+    //8个路径，按i&7轮流使用
+    const std::vector<std::string> paths={"/index.html","/css/bootstrap.min.css","/js/jquery-1.12.4.min.js",
+                                          "/images/profile-image.png","/video/xxx.mp4","/README","/fonts/a.woff2",
+                                          "/picture.jpeg"};
+    printf("%ld lookups over %zu paths\n",lookups,paths.size());
+
+    size_t sink=0;
+    auto begin=std::chrono::steady_clock::now();
+    for(long i=0;i<lookups;++i){
+        sink+=old_type(map,paths[i&7]).size();
+    }
+    printf("%-24s %8.2f ns/lookup\n","unordered_map + substr",elapsed_ns(begin)/lookups);
+
+    begin=std::chrono::steady_clock::now();
+    for(long i=0;i<lookups;++i){
+        sink+=new_type(TABLE,paths[i&7]).size();
+    }
+    printf("%-24s %8.2f ns/lookup\n","MimeTable (constexpr)",elapsed_ns(begin)/lookups);
+
+    //运行时生成：内置类型加上配置的后缀，共150项
+    std::vector<std::string> strings;
+    strings.reserve(2*(std::size(TYPES)+131));
+    for(int i=0;i<131;++i){
+        strings.push_back(".x"+std::to_string(i));
+        strings.push_back("Content-Type: application/x-"+std::to_string(i)+"\r\n");
+    }
+    std::vector<MimeTable::Entry> entries(std::begin(TYPES),std::end(TYPES));
+    for(size_t i=0;i<strings.size();i+=2){
+        entries.push_back(MimeTable::Entry{strings[i],strings[i+1]});
+    }
+    begin=std::chrono::steady_clock::now();
+    MimeTable runtime(entries.data(),entries.size());
+    double build=elapsed_ns(begin);
+    if(!runtime.Valid()){
+        fprintf(stderr,"cannot build runtime table\n");
+        return 1;
+    }
+    begin=std::chrono::steady_clock::now();
+    for(long i=0;i<lookups;++i){
+        sink+=new_type(runtime,paths[i&7]).size();
+    }
+    printf("%-24s %8.2f ns/lookup   %zu entries, built in %.0f us (%zu)\n","MimeTable (runtime)",
+           elapsed_ns(begin)/lookups,runtime.Size(),build/1000,sink);
+    return 0;
+}
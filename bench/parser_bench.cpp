@@ -0,0 +1,197 @@
+/*
+ * @parser_bench.cpp
+ * -----------------
+ * HttpRequest 解析器微基准：对比状态机解析器与原先基于 std::regex 的解析器，
+ * 并分别测量 DelimiterScanner 各个实现（标量/SSE4.2/AVX2）扫描 CR、LF、':' 的速度。
+ *
+ * 请求样本模仿浏览器访问 resources/ 下页面时发出的请求（index.html 与其引用的 css/js/图片）。
+ * 每轮把请求写入 Buffer 后解析，统计每个请求的平均耗时。
+ *
+ * 用法：
+ *   make bench && ./bin/parser_bench [轮数]
+ */
+#include"HttpRequest.h"
+#include"scanner.h"
+#include<chrono>
+#include<regex>
+#include<cstdio>
+#include<cstdlib>
+
+//原先的解析器（逐行 std::regex 匹配，每行拷贝为 std::string），仅用于对比
+class LegacyHttpRequest{
+    private:
+    enum PARSE_STATE{REQUEST_LINE,HEADERS,BODY,FINISH};
+    PARSE_STATE State_;
+    std::string Method_,Path_,Version_,Body_;
+    std::unordered_map<std::string,std::string>Header_;
+    bool Parse_Request_Line_(const std::string& Line){
+        std::regex Patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+        std::smatch SubMatch;
+        if(regex_match(Line,SubMatch,Patten)){
+            Method_=SubMatch[1];
+            Path_=SubMatch[2];
+            Version_=SubMatch[3];
+            State_=HEADERS;
+            return true;
+        }
+        return false;
+    }
+    void Parse_Reauest_Header_(const std::string& Line){
+        std::regex Patten("^([^:]*): ?(.*)$");
+        std::smatch SubMatch;
+        if(regex_match(Line,SubMatch,Patten)){
+            Header_[SubMatch[1]]=SubMatch[2];
+        }else{
+            State_=BODY;
+        }
+    }
+    public:
+    void Init(){
+        Method_=Path_=Version_=Body_="";
+        State_=REQUEST_LINE;
+        Header_.clear();
+    }
+    bool Parse(Buffer& Buff){
+        const char CRLF[]="\r\n";
+        if(Buff.How_Many_Bytes_We_Need_Read()<=0){
+            return false;
+        }
+        while(Buff.How_Many_Bytes_We_Need_Read()&&State_!=FINISH){
+            const char* Line_End=std::search(Buff.Where_Did_We_Read(),Buff.Where_Did_We_Write_Const(),CRLF,CRLF+2);
+            std::string Line(Buff.Where_Did_We_Read(),Line_End);
+            switch(State_){
+                case REQUEST_LINE:
+                    if(!Parse_Request_Line_(Line)){
+                        return false;
+                    }
+                    break;
+                case HEADERS:
+                    Parse_Reauest_Header_(Line);
+                    if(Buff.How_Many_Bytes_We_Need_Read()<=2){
+                        State_=FINISH;
+                    }
+                    break;
+                case BODY:
+                    Body_=Line;
+                    State_=FINISH;
+                    break;
+                default:
+                    break;
+            }
+            if(Line_End==Buff.Where_Did_We_Write()){
+                break;
+            }
+            Buff.Update_ReadPos(Line_End+2);
+        }
+        return true;
+    }
+    const std::string& Path() const{
+        return Path_;
+    }
+};
+
+static const char* REQUESTS[]={
+    "GET / HTTP/1.1\r\n"
+    "Host: 192.168.1.10:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n",
+    "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+    "Host: 192.168.1.10:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Referer: http://192.168.1.10:8080/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "If-Modified-Since: Tue, 30 Jun 2020 08:00:00 GMT\r\n"
+    "\r\n",
+    "GET /images/profile-image.jpg HTTP/1.1\r\n"
+    "Host: 192.168.1.10:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Referer: http://192.168.1.10:8080/picture\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n",
+};
+static const size_t REQUEST_COUNT=sizeof(REQUESTS)/sizeof(REQUESTS[0]);
+
+template<typename Parser>
+static double run(Parser& parser,int rounds,size_t& checksum){
+    Buffer buffer;
+    auto begin=std::chrono::steady_clock::now();
+    for(int i=0;i<rounds;++i){
+        const char* request=REQUESTS[i%REQUEST_COUNT];
+        buffer.Write_to_Buffer(request,strlen(request));
+        parser.Init();
+        parser.Parse(buffer);
+        checksum+=parser.Path().size();
+        //丢弃未被解析器消费的数据，保证每轮从一个完整请求开始
+        buffer.Update_ReadPos(buffer.How_Many_Bytes_We_Need_Read());
+    }
+    auto end=std::chrono::steady_clock::now();
+    return std::chrono::duration<double,std::nano>(end-begin).count()/rounds;
+}
+
+//扫描全部请求样本，返回每字节耗时(ns)
+static double run_scanner(DelimiterScanner::Scan_Func scan,const std::string& text,int rounds,size_t& checksum){
+    uint32_t out[64];
+    auto begin=std::chrono::steady_clock::now();
+    for(int i=0;i<rounds;++i){
+        size_t pos=0;
+        while(pos<text.size()){
+            size_t count=scan(text.data(),pos,text.size(),out,64);
+            for(size_t j=0;j<count;++j){
+                checksum+=out[j];
+            }
+        }
+    }
+    auto end=std::chrono::steady_clock::now();
+    return std::chrono::duration<double,std::nano>(end-begin).count()/rounds/text.size();
+}
+
+int main(int argc,char* argv[]){
+    int rounds=argc>1?atoi(argv[1]):200000;
+    size_t checksum=0;
+    HttpRequest parser;
+    LegacyHttpRequest legacy;
+    //预热
+    run(parser,rounds/10+1,checksum);
+    run(legacy,rounds/100+1,checksum);
+    double fast=run(parser,rounds,checksum);
+    double slow=run(legacy,rounds/10+1,checksum);
+    printf("state machine parser: %10.1f ns/request\n",fast);
+    printf("regex parser        : %10.1f ns/request\n",slow);
+    printf("speedup             : %10.1fx   (checksum %zu)\n",slow/fast,checksum);
+
+    std::string text;
+    for(size_t i=0;i<REQUEST_COUNT;++i){
+        text+=REQUESTS[i];
+    }
+    struct{const char* name;DelimiterScanner::Scan_Func scan;bool usable;}scanners[]={
+        {"scalar",DelimiterScanner::Scan_Scalar,true},
+        {"sse4.2",DelimiterScanner::Scan_Sse42,DelimiterScanner::Has_Sse42()},
+        {"avx2",DelimiterScanner::Scan_Avx2,DelimiterScanner::Has_Avx2()},
+    };
+    printf("delimiter scanner (selected: %s, %zu bytes of headers)\n",DelimiterScanner::Name(),text.size());
+    size_t expected=0;
+    run_scanner(DelimiterScanner::Scan_Scalar,text,1,expected);
+    for(auto& item:scanners){
+        if(!item.usable){
+            printf("  %-6s: not supported by this CPU\n",item.name);
+            continue;
+        }
+        size_t sum=0;
+        run_scanner(item.scan,text,1,sum);
+        double ns=run_scanner(item.scan,text,rounds,checksum);
+        printf("  %-6s: %8.3f ns/byte %8.2f GB/s%s\n",item.name,ns,1/ns,sum==expected?"":"  MISMATCH");
+    }
+    return 0;
+}
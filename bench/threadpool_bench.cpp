@@ -0,0 +1,227 @@
+/*
+ * @threadpool_bench.cpp
+ * ---------------------
+ * CoroutineThreadPool 微基准。
+ *
+ * 1. 吞吐：一个生产者线程不断投递只做一次原子加法的小任务（与 handle_read_ 中捕获 this 和连接指针的
+ *    lambda 大小相同），对比 submit() 与 post() 的每秒任务数和每个任务的堆分配次数。
+ *    堆分配次数通过替换全局 operator new 计数。
+ * 2. 突发负载下的尾延迟：生产者每隔随机的空闲时间投递一批任务，每个任务做约1微秒的计算，
+ *    统计从投递到开始执行的延迟分位数。对比工作窃取 + futex 停靠的线程池与原先的实现
+ *    （所有线程争用同一个队列，空闲时在条件变量上 wait_for 100ms）。
+ *
+ * 用法：
+ *   make bench && ./bin/threadpool_bench [任务数] [工作线程数] [突发批数]
+ */
+#include"ThreadPool.h"
+#include<condition_variable>
+#include<algorithm>
+#include<random>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size){
+    allocations.fetch_add(1,std::memory_order_relaxed);
+    if(void* p=malloc(size)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept{
+    free(p);
+}
+void operator delete(void* p,size_t) noexcept{
+    free(p);
+}
+
+//原先的post()路径（单个有界环形队列 + 条件变量），仅用于对比
+class LegacyThreadPool{
+    public:
+    explicit LegacyThreadPool(size_t threads):stop_(false),slots_(new Slot[CAPACITY]){
+        for(size_t i=0;i<CAPACITY;++i){
+            slots_[i].sequence.store(i,std::memory_order_relaxed);
+        }
+        for(size_t i=0;i<threads;++i){
+            threads_.emplace_back([this]{worker_loop();});
+        }
+    }
+    ~LegacyThreadPool(){
+        stop_=true;
+        cv_.notify_all();
+        for(auto& t:threads_){
+            t.join();
+        }
+    }
+    template<typename F>
+    void post(F&& f){
+        using Fn=std::decay_t<F>;
+        static_assert(sizeof(Fn)<=sizeof(Slot::storage)&&std::is_trivially_copyable_v<Fn>);
+        size_t pos=tail_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for(;;){
+            slot=&slots_[pos&(CAPACITY-1)];
+            intptr_t diff=static_cast<intptr_t>(slot->sequence.load(std::memory_order_acquire))-static_cast<intptr_t>(pos);
+            if(diff==0){
+                if(tail_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)){
+                    break;
+                }
+            }else if(diff<0){
+                std::this_thread::yield();
+                pos=tail_.load(std::memory_order_relaxed);
+            }else{
+                pos=tail_.load(std::memory_order_relaxed);
+            }
+        }
+        new(slot->storage) Fn(std::forward<F>(f));
+        slot->invoke=[](void* p){(*static_cast<Fn*>(p))();};
+        slot->sequence.store(pos+1,std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(sleepers_.load(std::memory_order_relaxed)>0){
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_one();
+        }
+    }
+    private:
+    static const size_t CAPACITY=4096;
+    struct alignas(64) Slot{
+        std::atomic<size_t> sequence;
+        void (*invoke)(void*);
+        alignas(16) unsigned char storage[48];
+    };
+    bool run_one_(){
+        size_t pos=head_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for(;;){
+            slot=&slots_[pos&(CAPACITY-1)];
+            intptr_t diff=static_cast<intptr_t>(slot->sequence.load(std::memory_order_acquire))-static_cast<intptr_t>(pos+1);
+            if(diff==0){
+                if(head_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)){
+                    break;
+                }
+            }else if(diff<0){
+                return false;
+            }else{
+                pos=head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->invoke(slot->storage);
+        slot->sequence.store(pos+CAPACITY,std::memory_order_release);
+        return true;
+    }
+    void worker_loop(){
+        while(!stop_){
+            if(run_one_()){
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleepers_.fetch_add(1,std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cv_.wait_for(lock,std::chrono::milliseconds(100),[&]{
+                return stop_||tail_.load()!=head_.load();
+            });
+            sleepers_.fetch_sub(1,std::memory_order_relaxed);
+        }
+    }
+    std::atomic<bool> stop_;
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> sleepers_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+struct Counter{
+    alignas(64) std::atomic<size_t> done{0};
+};
+
+static int64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Dispatch>
+static void run_throughput(const char* name,size_t tasks,size_t threads,Dispatch dispatch){
+    Counter counter;
+    void* self=&counter;
+    {
+        CoroutineThreadPool pool(threads,500);
+        size_t before=allocations.load();
+        auto begin=std::chrono::steady_clock::now();
+        for(size_t i=0;i<tasks;++i){
+            dispatch(pool,[self,&counter]{
+                (void)self;
+                counter.done.fetch_add(1,std::memory_order_relaxed);
+            });
+        }
+        while(counter.done.load(std::memory_order_relaxed)<tasks){
+            std::this_thread::yield();
+        }
+        double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+        size_t allocated=allocations.load()-before;
+        printf("%-16s %10.0f tasks/s   %6.1f ns/task   %.2f allocations/task\n",
+               name,tasks/seconds,seconds*1e9/tasks,static_cast<double>(allocated)/tasks);
+    }
+}
+
+//约1微秒的计算
+static void busy_work(){
+    int64_t end=now_ns()+1000;
+    while(now_ns()<end){
+    }
+}
+
+template<typename Pool>
+static void run_bursty(const char* name,size_t threads,size_t bursts){
+    const size_t burst_size=64;
+    std::vector<int64_t> latency(bursts*burst_size);
+    Counter counter;
+    std::mt19937 rng(12345);
+    {
+        Pool pool(threads);
+        int64_t* out=latency.data();
+        size_t id=0;
+        for(size_t b=0;b<bursts;++b){
+            //随机长度的空闲期，足以让工作线程停靠
+            std::this_thread::sleep_for(std::chrono::microseconds(200+rng()%1800));
+            for(size_t i=0;i<burst_size;++i,++id){
+                int64_t posted=now_ns();
+                Counter* done=&counter;
+                pool.post([out,id,posted,done]{
+                    out[id]=now_ns()-posted;
+                    busy_work();
+                    done->done.fetch_add(1,std::memory_order_relaxed);
+                });
+            }
+        }
+        while(counter.done.load()<latency.size()){
+            std::this_thread::yield();
+        }
+    }
+    std::sort(latency.begin(),latency.end());
+    auto at=[&](double q){
+        return latency[std::min(latency.size()-1,static_cast<size_t>(q*latency.size()))]/1000.0;
+    };
+    printf("%-16s p50 %8.1f us   p99 %8.1f us   p99.9 %8.1f us   max %8.1f us\n",
+           name,at(0.5),at(0.99),at(0.999),latency.back()/1000.0);
+}
+
+int main(int argc,char* argv[]){
+    size_t tasks=argc>1?strtoul(argv[1],nullptr,10):1000000;
+    size_t threads=argc>2?strtoul(argv[2],nullptr,10):4;
+    size_t bursts=argc>3?strtoul(argv[3],nullptr,10):2000;
+    printf("throughput: %zu tasks, %zu worker threads\n",tasks,threads);
+    run_throughput("submit",tasks,threads,[](CoroutineThreadPool& pool,auto&& task){
+        pool.submit(task);
+    });
+    run_throughput("post",tasks,threads,[](CoroutineThreadPool& pool,auto&& task){
+        pool.post(task);
+    });
+    printf("bursty latency: %zu bursts of 64 tasks, %zu worker threads\n",bursts,threads);
+    run_bursty<LegacyThreadPool>("shared queue+cv",threads,bursts);
+    run_bursty<CoroutineThreadPool>("work stealing",threads,bursts);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * @timer_bench.cpp
+ * ----------------
+ * TimerManager 微基准：对比分层时间轮与原先的小根堆 + unordered_map 索引。
+ *
+ * 模拟大量 keep-alive 连接：先为每个连接添加一个超时定时器，然后在随机连接上反复刷新
+ * （对应每次读写事件的 extent_time_），并周期性地调用 get_next_timer_handle（对应每次 epoll_wait 前）。
+ * 最后用毫秒级的短超时检查两者都能按时触发全部定时器。
+ *
+ * 用法：
+ *   make bench && ./bin/timer_bench [连接数] [刷新次数]
+ */
+#include"timer.h"
+#include<unordered_map>
+#include<random>
+#include<cstdio>
+#include<cstdlib>
+
+//原先的定时器（小根堆，id到堆下标的unordered_map），仅用于对比
+class LegacyTimerManager{
+    private:
+    struct node{
+        int id;
+        time_stamp expire;
+        timeout_callback call_back;
+        bool operator<(const node& t){
+            return expire<t.expire;
+        }
+    };
+    std::vector<node>heap_;
+    std::unordered_map<int,size_t>ref_;
+    void siftup_(size_t index){
+        while(index>0){
+            size_t j=(index-1)/2;
+            if(heap_[j]<heap_[index]){
+                break;
+            }
+            swap_node_(index,j);
+            index=j;
+        }
+    }
+    bool siftdown_(size_t index,size_t n){
+        size_t i=index;
+        size_t j=i*2+1;
+        while(j<n){
+            if(j+1<n&&heap_[j+1]<heap_[j]){
+                j++;
+            }else if(heap_[i]<heap_[j]){
+                break;
+            }
+            swap_node_(i,j);
+            i=j;
+            j=i*2+1;
+        }
+        return i>index;
+    }
+    void swap_node_(size_t index1,size_t index2){
+        std::swap(heap_[index1],heap_[index2]);
+        ref_[heap_[index1].id]=index1;
+        ref_[heap_[index2].id]=index2;
+    }
+    void del_(size_t index){
+        size_t i=index;
+        size_t n=heap_.size()-1;
+        if(i<n){
+            swap_node_(i,n);
+            if(!siftdown_(i,n)){
+                siftup_(i);
+            }
+        }
+        ref_.erase(heap_.back().id);
+        heap_.pop_back();
+    }
+    public:
+    void add_timer(int id,int time_out,const timeout_callback& call_back){
+        size_t i;
+        if(ref_.count(id)==0){
+            i=heap_.size();
+            ref_[id]=i;
+            heap_.push_back({id,hr_clock::now()+ms(time_out),call_back});
+            siftup_(i);
+        }else{
+            i=ref_[id];
+            heap_[i].expire=hr_clock::now()+ms(time_out);
+            heap_[i].call_back=call_back;
+            if(!siftdown_(i,heap_.size())){
+                siftup_(i);
+            }
+        }
+    }
+    void update(int id,int time_out){
+        heap_[ref_[id]].expire=hr_clock::now()+ms(time_out);
+        siftdown_(ref_[id],heap_.size());
+    }
+    int get_next_timer_handle(){
+        while(!heap_.empty()){
+            node front=heap_.front();
+            if(std::chrono::duration_cast<ms>(front.expire-hr_clock::now()).count()>0){
+                break;
+            }
+            front.call_back();
+            del_(0);
+        }
+        ssize_t res=-1;
+        if(!heap_.empty()){
+            res=std::chrono::duration_cast<ms>(heap_.front().expire-hr_clock::now()).count();
+            if(res<0){
+                res=0;
+            }
+        }
+        return res;
+    }
+    size_t size() const{
+        return heap_.size();
+    }
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point begin){
+    return std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-begin).count();
+}
+
+template<typename Timer>
+static void run(const char* name,int connections,int refreshes){
+    Timer timer;
+    size_t fired=0;
+    std::mt19937 rng(12345);
+    //添加：每个连接一个60秒的超时定时器
+    auto begin=std::chrono::steady_clock::now();
+    for(int id=0;id<connections;++id){
+        timer.add_timer(id,60000,[&fired]{++fired;});
+    }
+    double add=elapsed_ns(begin)/connections;
+    //刷新：随机连接上的读写事件，每64次事件一次epoll_wait
+    std::vector<int>ids(refreshes);
+    for(auto& id:ids){
+        id=rng()%connections;
+    }
+    begin=std::chrono::steady_clock::now();
+    int wait=0;
+    for(int i=0;i<refreshes;++i){
+        timer.update(ids[i],60000);
+        if((i&63)==0){
+            wait+=timer.get_next_timer_handle();
+        }
+    }
+    double refresh=elapsed_ns(begin)/refreshes;
+    //到期：短超时的定时器全部按时触发
+    Timer expiring;
+    size_t expired=0;
+    int short_count=std::min(connections,20000);
+    for(int id=0;id<short_count;++id){
+        expiring.add_timer(id,1+rng()%50,[&expired]{++expired;});
+    }
+    begin=std::chrono::steady_clock::now();
+    while(expired<static_cast<size_t>(short_count)&&elapsed_ns(begin)<2e9){
+        expiring.get_next_timer_handle();
+    }
+    double drain=elapsed_ns(begin)/1e6;
+    printf("%-12s add %7.1f ns   refresh+wait %7.1f ns   fired %zu/%d in %.1f ms   (early fires %zu, wait sum %d)\n",
+           name,add,refresh,expired,short_count,drain,fired,wait);
+}
+
+int main(int argc,char* argv[]){
+    int connections=argc>1?atoi(argv[1]):100000;
+    int refreshes=argc>2?atoi(argv[2]):2000000;
+    printf("%d connections, %d refreshes\n",connections,refreshes);
+    run<LegacyTimerManager>("binary heap",connections,refreshes);
+    run<TimerManager>("timing wheel",connections,refreshes);
+    return 0;
+}
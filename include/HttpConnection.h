@@ -8,31 +8,57 @@
  * - 负责连接的初始化、关闭、读写缓冲区管理
  * - 解析 HTTP 请求并生成 HTTP 响应
  * - 支持长连接（keep-alive）和文件映射响应
+ * - 支持 HTTP/1.1 流水线：一次处理读缓冲区中所有完整的请求，响应按顺序排队后一次写出；
+ *   排队的输出超过 pipeline_output_limit 时暂停解析（背压），遇到不保持连接的请求后不再处理后面的请求
+ * - 读写缓冲区只在有数据收发时从 BufferPool 借用存储块，空闲与关闭的连接不占用缓冲区内存
+ * - 待发送的数据放在分段输出队列（OutputQueue）中，各段引用写缓冲区、内存映射等处的内存，不拷贝；
+ *   连续的内存段一次 writev 写出，部分写出后每段从中断处继续
+ * - 大文件（不小于 sendfile_threshold）以文件段用 sendfile 零拷贝发送，响应头以 MSG_MORE 发送与文件首段合并；
+ *   小文件仍然用 writev 从内存映射发送
  *
  * 类 HttpConnection 提供如下接口：
  *   HttpConnection()                        // 构造函数，初始化连接状态
  *   ~HttpConnection()                       // 析构函数，关闭连接
- *   void init_httpconnection(int fd, const sockaddr_in& addr) // 初始化连接
+ *   void init_httpconnection(int fd, const sockaddr_in& addr, bool use_sendfile) // 初始化连接，完成式后端不使用 sendfile
  *   void close_httpconnection()             // 关闭连接并释放资源
  *   int get_Fd() const                      // 获取连接的文件描述符
  *   struct sockaddr_in get_addr() const     // 获取客户端地址
  *   const char* get_ip() const              // 获取客户端 IP 字符串
  *   int get_port() const                    // 获取客户端端口
  *   ssize_t read_buffer(int* save_erron)    // 从连接读取数据到缓冲区
- *   ssize_t write_buffer(int* save_erron)   // 将缓冲区数据写入连接
- *   int get_write_length()                  // 获取待写入数据长度
+ *   ssize_t write_buffer(int* save_erron)   // 将缓冲区数据写入连接，EAGAIN 后再次调用从中断处继续
+ *   int get_write_length()                  // 获取待写入数据长度（含 sendfile 尚未发送的部分）
+ *   const iovec* get_iov(int* count)        // 获取待写入数据的 iovec 数组与数量（完成式后端提交 writev 用）
+ *   void update_iov(size_t length)          // 已写出 length 字节后推进输出队列
+ *   void fill_read_buffer(const char*, size_t) // 将后端已接收的数据追加到读缓冲区
  *   bool get_alive_status() const           // 判断连接是否为长连接
- *   bool handle_httpconnection()            // 处理 HTTP 请求并生成响应
+ *   bool handle_httpconnection()            // 处理读缓冲区中所有完整的请求（流水线），响应按顺序加入输出队列；
+ *                                           // 没有完整请求时返回 false 并保留解析进度
+ *   IoAwaiter async_read(int* save_erron)   // 读到新数据、对端关闭或出错时返回；EAGAIN 时挂起协程，等待可读后再读一次
+ *   IoAwaiter async_write(int* save_erron)  // 写出待写数据；写不完时挂起协程，等待可写后再写一次
+ *   void attach_coroutine(IoCoroutine co)   // 连接持有处理协程，关闭连接时销毁
+ *   bool resume_coroutine()                 // 恢复协程，协程结束（连接应关闭）时返回 false
+ *   uint32_t get_waiting_events() const     // 协程挂起时等待的事件（EPOLLIN/EPOLLOUT），没有挂起时为 0
+ *   bool try_dispatch()                     // Reactor 线程：空闲时标记为运行中并返回 true（由调用方恢复协程）；
+ *                                           // 协程正在运行时记下这次事件（DISPATCH_PENDING），请求关闭后忽略
+ *   uint32_t finish_dispatch()              // 恢复协程的线程重新注册描述符后调用：没有新事件与关闭请求时回到空闲并返回 0，
+ *                                           // 否则返回 DISPATCH_PENDING/DISPATCH_CLOSING（取走 DISPATCH_PENDING）
+ *   bool request_close()                    // 请求关闭，协程空闲（挂起且未投递）时返回 true，调用方可以立即关闭
+ *   bool is_closing() const                 // 是否已请求关闭
+ *   void take_ownership()                   // 当前线程接管读写缓冲区；init_httpconnection 与 resume_coroutine 会自动调用
+ *   std::shared_ptr<const void> release_output() // 交出输出队列与写缓冲区的存储块（完成式后端关闭连接时，
+ *                                           // 由事件后端保持到已提交的 writev 完成），没有待写数据时返回 nullptr
+ *   MemoryStats get_memory_stats() const    // 连接当前借用的缓冲区内存（空闲的长连接为 0）
  *
  * 使用说明：
  * 1. 创建 HttpConnection 对象，调用 init_httpconnection 初始化连接。
- * 2. 使用 read_buffer/write_buffer 进行数据收发。
+ * 2. 使用 read_buffer/write_buffer 进行数据收发（就绪式后端在协程中使用 co_await async_read/async_write）。
  * 3. 调用 handle_httpconnection 解析请求并生成响应。
  * 4. 连接结束时调用 close_httpconnection 释放资源。
  *
  * 依赖：
- * - sys/socket.h, netinet/in.h, unistd.h, sys/uio.h 等头文件
- * - 相关 HTTP 请求/响应解析与缓冲区管理类
+ * - sys/socket.h, netinet/in.h, unistd.h, sys/uio.h, sys/sendfile.h 等头文件
+ * - 相关 HTTP 请求/响应解析、缓冲区管理与输出队列类
  *
  * 路径：webserve/src/HttpConnection.cpp
  */
@@ -40,9 +66,16 @@
 #include"buffer.h"
 #include"HttpResponse.h"
 #include"HttpRequest.h"
+#include"io_coroutine.h"
+#include"output_queue.h"
 
 #include<arpa/inet.h> //sockaddr_in
 #include<sys/uio.h> //readv/writev
+#include<sys/socket.h> //send
+#include<sys/sendfile.h> //sendfile
+#include<sys/epoll.h> //EPOLLIN,EPOLLOUT
+#include<coroutine>
+#include<atomic>
 #include<iostream>
 #include<sys/types.h>
 #include<assert.h>
@@ -59,27 +92,118 @@ class HttpConnection{
     struct sockaddr_in addr_;
     //标记是否关闭连接
     bool close_or_not;
-    //用于存储iovec结构体数组的数量
-    int iov_count_;
-    //用于存储分散/聚集I/O操作的数据块信息
-    struct iovec iov_[2];
+    //是否允许用sendfile发送文件（完成式后端只提交writev）
+    bool use_sendfile_;
+    //最后一个已处理的请求是否保持连接
+    bool keep_alive_;
+    //读写缓冲区只在有数据收发时借用存储块，请求处理完、响应写完后归还
     Buffer read_buffer_;
     Buffer write_buffer_;
     HttpRequest request_;
     HttpResponse response_;
+    //待发送的数据：响应头(写缓冲区中的段)、文件内容(内存映射或sendfile)按顺序排列
+    OutputQueue output_;
+    //处理本连接的协程，以及它挂起时等待的事件
+    std::coroutine_handle<> coroutine_;
+    uint32_t waiting_events_;
+    //调度状态（DISPATCH_*）：协程是否已投递或正在运行、运行期间是否又有事件、是否请求关闭
+    std::atomic<uint32_t> dispatch_state_;
+
+    //交出的输出：队列中的段（含iovec数组与持有者引用）与写缓冲区的存储块
+    struct ReleasedOutput_{
+        OutputQueue Output;
+        Buffer Write_Buffer;
+    };
+
+    //为刚解析完的请求生成响应，加入输出队列
+    void queue_response_();
+    //尝试一次读(EPOLLIN)或写(EPOLLOUT)，需要等待描述符就绪时返回false
+    bool try_io_(uint32_t events,int* save_erron,ssize_t* result);
 
     public:
+    //调度状态：空闲（协程挂起且未投递，Reactor线程可以直接关闭）、已投递或正在运行、
+    //运行期间又有事件、请求关闭（由恢复协程的线程交还Reactor线程关闭）
+    static constexpr uint32_t DISPATCH_IDLE=0;
+    static constexpr uint32_t DISPATCH_RUNNING=1;
+    static constexpr uint32_t DISPATCH_PENDING=2;
+    static constexpr uint32_t DISPATCH_CLOSING=4;
+    //连接当前借用的缓冲区内存
+    struct MemoryStats{
+        size_t read_buffer_bytes;
+        size_t write_buffer_bytes;
+        size_t total() const{
+            return read_buffer_bytes+write_buffer_bytes;
+        }
+    };
+    //co_await的对象：先直接尝试读写，会阻塞时挂起协程，恢复后再尝试一次
+    class IoAwaiter{
+        public:
+        IoAwaiter(HttpConnection* connection,uint32_t events,int* save_erron):
+        connection_(connection),events_(events),save_erron_(save_erron),result_(-1){}
+        bool await_ready(){
+            return connection_->try_io_(events_,save_erron_,&result_);
+        }
+        void await_suspend(std::coroutine_handle<>){
+            //由恢复协程的一方按该事件重新注册描述符
+            connection_->waiting_events_=events_;
+        }
+        ssize_t await_resume(){
+            if(connection_->waiting_events_){
+                connection_->waiting_events_=0;
+                connection_->try_io_(events_,save_erron_,&result_);
+            }
+            return result_;
+        }
+        private:
+        HttpConnection* connection_;
+        uint32_t events_;
+        int* save_erron_;
+        ssize_t result_;
+    };
+
     HttpConnection();
     ~HttpConnection();
-    void init_httpconnection(int socketFd,const sockaddr_in& addr);
+    void init_httpconnection(int socketFd,const sockaddr_in& addr,bool use_sendfile=true);
     ////每个连接中定义的对缓冲区的读接口
     ssize_t read_buffer(int* save_errono);
     ////每个连接中定义的对缓冲区的写接口
     ssize_t write_buffer(int* save_errono);
+    //已写出length字节后推进iovec
+    void update_iov(size_t length);
+    //将事件后端已经接收到的数据追加到读缓冲区
+    void fill_read_buffer(const char* data,size_t length);
     //关闭HTTP连接
     void close_httpconnection();
     //处理HTTP连接，主要分为request的解析和response的生成
     bool handle_httpconnection();
+    //读到新数据（返回本次读到的字节数）、对端关闭（0）或出错（-1）时返回，EAGAIN时挂起
+    IoAwaiter async_read(int* save_erron){
+        return IoAwaiter(this,EPOLLIN,save_erron);
+    }
+    //写出待写数据，写不完时挂起，恢复后再写一次；调用方在get_write_length()>0时循环
+    IoAwaiter async_write(int* save_erron){
+        return IoAwaiter(this,EPOLLOUT,save_erron);
+    }
+    //持有处理本连接的协程
+    void attach_coroutine(IoCoroutine co);
+    //恢复协程，协程已结束时返回false
+    bool resume_coroutine();
+    //协程挂起时等待的事件
+    uint32_t get_waiting_events() const;
+    //Reactor线程：空闲时标记为运行中并返回true，运行中时记下这次事件，请求关闭后忽略
+    bool try_dispatch();
+    //恢复协程的线程重新注册描述符后调用：回到空闲时返回0，否则返回DISPATCH_PENDING/DISPATCH_CLOSING
+    uint32_t finish_dispatch();
+    //请求关闭，协程空闲时返回true
+    bool request_close();
+    //是否已请求关闭
+    bool is_closing() const;
+    //当前线程接管连接的读写缓冲区（连接在Reactor线程与工作线程之间移动时调用）
+    void take_ownership();
+    //连接当前借用的缓冲区内存，空闲的长连接为0
+    MemoryStats get_memory_stats() const;
+    //交出待写的输出（段、iovec与写缓冲区的存储块），连接之后没有待写数据；没有待写数据时返回nullptr
+    std::shared_ptr<const void> release_output();
     
     //获得IP
     const char* get_ip() const;
@@ -91,11 +215,17 @@ class HttpConnection{
     sockaddr_in get_addr() const;
     //获得要写入的长度
     int get_write_length();
+    //获得待写入数据的iovec数组及数量，下一次update_iov之前保持有效
+    const struct iovec* get_iov(int* count);
     //获得是否保持连接的判断
     bool get_alive_status() const;
     //标记是否使用边缘触发
     static bool isEt;
     static const char* srcDir;
+    //文件不小于该长度时使用sendfile发送，0表示不使用
+    static size_t sendfile_threshold;
+    //流水线请求排队的输出超过该字节数时暂停解析（至少处理一个请求）
+    static size_t pipeline_output_limit;
     static std::atomic<size_t>user_count;
     
 };
\ No newline at end of file
@@ -4,7 +4,9 @@
  * 这是一个 HTTP 请求解析类的实现文件，适用于 Web 服务器对 HTTP 请求的处理。
  *
  * 主要功能：
- * - 解析 HTTP 请求行、请求头和请求体
+ * - 手写的可恢复状态机，逐行解析 HTTP 请求行、请求头和请求体，不使用正则表达式
+ * - 行尾与请求头的 ':' 由 DelimiterScanner（AVX2/SSE4.2/标量）一次扫描得到，每个字节只扫描一次
+ * - 零拷贝：方法、路径、版本、请求头均以 std::string_view 指向连接的读缓冲区，常规路径上不分配内存
  * - 支持 GET 和 POST 请求
  * - 处理 URL 编码的表单数据
  * - 路径和方法的提取与规范化
@@ -12,30 +14,39 @@
  *
  * 类 HttpRequest 提供如下接口：
  *   void Init()                         // 初始化请求对象，重置状态
- *   bool Parse(Buffer& Buff)            // 解析缓冲区中的 HTTP 请求
- *   std::string Path() const            // 获取请求路径
- *   std::string Method() const          // 获取请求方法
- *   std::string Version() const         // 获取 HTTP 版本
- *   std::string Get_Post(const std::string& key) const // 获取 POST 表单字段
+ *   HTTP_CODE Parse(Buffer& Buff)       // 解析缓冲区中的 HTTP 请求：
+ *                                       //   GET_REQUEST 完整请求已解析并从缓冲区消费
+ *                                       //   NO_REQUEST  数据不完整，缓冲区保持不变，解析进度保留到下次调用
+ *                                       //   BAD_REQUEST 请求格式错误
+ *   bool Is_Finished() const            // 当前请求是否已解析完成
+ *   std::string_view Path() const       // 获取请求路径
+ *   std::string_view Method() const     // 获取请求方法
+ *   std::string_view Version() const    // 获取 HTTP 版本
+ *   std::string_view Header(std::string_view key) const // 按名称（不区分大小写）获取请求头
+ *   std::string Get_Post(const std::string& key) const  // 获取 POST 表单字段
  *   bool Are_You_Keep_Alive() const     // 检查是否为 keep-alive 连接
  *
  * 使用说明：
  * 1. 创建 HttpRequest 对象并调用 Init() 初始化。
- * 2. 调用 Parse 解析 Buffer 中的 HTTP 请求数据。
- * 3. 通过 Path、Method、Version、Get_Post 等接口获取请求信息。
+ * 2. 调用 Parse 解析 Buffer 中的 HTTP 请求数据；返回 NO_REQUEST 时在收到更多数据后对同一 Buffer 再次调用，
+ *    解析从上次停下的位置继续，已扫描过的字节不会重复扫描；请求完成后再调用 Init() 开始下一个请求。
+ * 3. 通过 Path、Method、Version、Header、Get_Post 等接口获取请求信息。
+ * 4. Path/Method/Version/Header 返回的视图指向读缓冲区，在读缓冲区下一次写入前有效；
+ *    Are_You_Keep_Alive 与 Get_Post 的结果在解析完成时已保存，不受此限制。
  *
  * 依赖：
- * - <regex>、<unordered_set>、<string>、<map>、<cassert> 等标准库
+ * - <string_view>、<unordered_map>、<string>、<cstring>、<cassert> 等标准库
  * - Buffer 类（用于管理网络数据缓冲区）
+ * - DelimiterScanner 类（CR/LF/':' 向量化扫描）
  *
  * 路径：webserve/src/HttpRequest.cpp
  */
 #pragma once
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
 #include "buffer.h"
+#include "scanner.h"
 class HttpRequest{
     public:
     //HTTP的请求信息,枚举类型，表示状态的变化
@@ -69,48 +80,93 @@ class HttpRequest{
         CLOSED_CONNECTION,
     };
     private:
-    //当前状态
+    //请求中的一段文本，以相对于读指针的偏移表示，缓冲区移动后仍然有效
+    struct Token_{
+        uint32_t Offset;
+        uint32_t Length;
+    };
+    //请求头个数上限
+    static const size_t MAX_HEADERS_=64;
+    //请求行与请求头的总长度上限
+    static const size_t MAX_HEADER_BYTES_=65536;
+    //请求体长度上限
+    static const size_t MAX_BODY_BYTES_=1<<20;
+    //一批分隔符偏移的容量
+    static const size_t DELIM_CAPACITY_=64;
+
+    //当前状态，跨多次读取保留
     PARSE_STATE State_;
-    //请求方法、请求路径、HTTP 版本、请求体
-    std::string Method_,Path_,Version_,Body_;
-    //unordered_map<std::string,std::string>键值对，键是唯一的，键值都是string
-    //headers["Host"]//键="www.example.com"//值;
-    //请求头映射
-    std::unordered_map<std::string,std::string>Header_;
+    //本次解析的基址（读缓冲区的读指针），Token_的偏移相对于它
+    const char* Base_;
+    //扫描器已扫描到的位置与当前行的起始位置，跨多次读取保留
+    size_t Scan_;
+    size_t Line_Start_;
+    //已扫描出、尚未处理的分隔符偏移（CR/LF/':'）
+    uint32_t Delims_[DELIM_CAPACITY_];
+    size_t Delim_Head_;
+    size_t Delim_Count_;
+    //当前行中第一个':'的偏移，没有时为NO_COLON_
+    static const size_t NO_COLON_=static_cast<size_t>(-1);
+    size_t Colon_;
+    //请求方法、请求目标、HTTP 版本、请求体
+    Token_ Method_,Target_,Version_,Body_;
+    //请求路径（请求目标去掉查询串）；默认页面改写为静态字符串
+    Token_ Path_;
+    std::string_view Path_Alias_;
+    //请求头（名称与值）
+    Token_ Header_Name_[MAX_HEADERS_];
+    Token_ Header_Value_[MAX_HEADERS_];
+    size_t Header_Count_;
+    //Content-Length
+    size_t Content_Length_;
+    //是否保持连接，解析请求头结束时确定
+    bool Keep_Alive_;
     //POST数据映射，post["username"]="agedcat";
     std::unordered_map<std::string,std::string>Post_;
-    //默认HTML文件集合，无序不重复集合（unordered_set）
-    static const std::unordered_set<std::string>DEFAULT_HTML_;
+    //默认HTML页面：简写路径与完整路径
+    static const std::string_view DEFAULT_HTML_[][2];
 
-    //解析请求行，使用正则表达式来匹配和提取请求行中的方法、路径和版本信息
-    bool Parse_Request_Line_(const std::string& Line);
-    //解析 HTTP 请求头部
-    void Parse_Reauest_Header_(const std::string& Line);
-    //解析 HTTP 请求体
-    void Parse_Data_Body_(const std::string& Line);
+    //解析请求行，提取方法、请求目标和版本信息
+    bool Parse_Request_Line_(const char* Begin,const char* End);
+    //解析一行 HTTP 请求头部，Colon为扫描器找到的第一个':'
+    bool Parse_Request_Header_(const char* Begin,const char* Colon,const char* End);
+    //请求头结束：确定请求体长度与是否保持连接
+    bool Finish_Headers_();
+    //取下一个行尾的偏移并记录途中的':'，已扫描的数据中没有行尾时返回false
+    bool Next_Line_End_(size_t Size,size_t& Line_End);
 
     //解析路径，将简写的路径扩展为完整的 HTML 文件路径
     void Parse_Path_();
     //解析Post数据
     void Parse_Post_();
 
+    //偏移转为视图
+    std::string_view View_(const Token_& Token) const;
+    //指针区间转为偏移
+    Token_ Make_Token_(const char* Begin,const char* End) const;
+    //不区分大小写比较
+    static bool Equal_Ignore_Case_(std::string_view Lhs,std::string_view Rhs);
     //将字符转换为十六进制数
     static int Convert_Hex(char ch);
     public:
+    HttpRequest();
     //初始化函数，构造时使用
     void Init();
-    //缓存Http请求信息
-    bool Parse(Buffer& buff);
+    //解析Http请求，数据不完整时保留进度
+    HTTP_CODE Parse(Buffer& buff);
+    //当前请求是否已解析完成
+    bool Is_Finished() const;
     //
-    std::string Path() const;
-    std::string& Path();
-    std::string Method() const;
-    
-    std::string Version() const;
+    std::string_view Path() const;
+    std::string_view Method() const;
+
+    std::string_view Version() const;
+    //根据名称获取请求头的值（不区分大小写），不存在时返回空视图
+    std::string_view Header(std::string_view Key) const;
     //根据键获取 POST 数据
     std::string Get_Post(const std::string& key) const;
     //根据键获取 POST 数据
     std::string Get_Post(const char* key) const;
     //判断Http连接是否alive
     bool Are_You_Keep_Alive() const;
-};
\ No newline at end of file
+};
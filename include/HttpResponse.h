@@ -7,45 +7,91 @@
  * - 生成标准 HTTP 响应报文（状态行、响应头、响应体）
  * - 支持常见 MIME 类型和错误页面映射
  * - 文件内容高效映射到内存（mmap），提升静态资源访问性能
+ * - 文件的描述符、状态信息与映射来自共享的 FileCache，热点文件不产生文件系统调用
  * - 支持 Keep-Alive 长连接
  * - 错误处理与自定义错误页面
  *
  * 类 HttpResponse 提供如下接口：
  *   HttpResponse()                              // 构造函数，初始化成员
- *   ~HttpResponse()                             // 析构函数，释放映射文件资源
- *   void Init(const std::string& srcDir, std::string& path, bool keepAlive, int code)
- *                                               // 初始化响应参数
- *   void make_Response(Buffer& buffer)          // 生成完整 HTTP 响应写入 buffer
+ *   ~HttpResponse()                             // 析构函数，释放对缓存文件的引用
+ *   void Init(const std::string& srcDir, std::string_view path, bool keepAlive, int code, const Conditions& conditions)
+ *                                               // 初始化响应参数，conditions 为请求的条件头、Range 与 Accept-Encoding（没有时为空），
+ *                                               // 只保存视图，须在请求的内存被覆盖之前调用 make_Response
+ *   static void set_Cache_Control(const std::unordered_map<std::string,int>& maxAge)
+ *                                               // 按 MIME 类型设置 Cache-Control 的 max-age（"*" 为默认值）
+ *   static size_t set_Mime_Types(const std::unordered_map<std::string,std::string>& types)
+ *                                               // 启动时增加或覆盖后缀与 MIME 类型（config.json 的 mime_types），重新生成查找表
+ *   const std::string* make_Response(Buffer& buffer)
+ *                                               // 生成响应：有缓存文件时返回缓存项中预先生成的响应头（调用方按引用发送），
+ *                                               // 否则把完整响应（响应头与错误页面）写入 buffer 并返回 nullptr
  *   char* file()                               // 获取映射文件指针
- *   size_t file_Length() const                 // 获取映射文件长度
+ *   void unmap_File()                          // 释放对缓存文件的引用（映射由 FileCache 管理）
+ *   size_t file_Length() const                 // 获取需要发送的文件长度（304 时为 0）
+ *   int file_Fd() const                        // 获取文件描述符（sendfile 用），没有时为 -1
+ *   file_Ref() const                           // 获取缓存文件的引用（输出队列持有到文件内容发送完）
+ *   const std::vector<Extent>& extents() const  // 需要发送的文件区间，每段之前先发送写入 buffer 的 Prefix 字节
  *
  * 内部机制：
  * - 根据请求路径和状态码选择响应文件
- * - 自动判断文件类型并设置 Content-Type
- * - 通过 mmap 映射文件，提升大文件传输效率
- * - 支持 200、400、403、404 等常见 HTTP 状态码
+ * - 自动判断文件类型并设置 Content-Type：后缀在编译期生成的完美哈希表（http_tables.h）中查找，
+ *   得到预先生成的 "Content-Type: ...\r\n" 响应头行，不分配内存；状态行与错误页面路径同样来自编译期生成的表
+ * - 状态行与响应头对同一文件、状态码与是否保持连接总是相同：第一次生成后存放在 FileCache 的缓存项中，
+ *   之后的请求直接引用，不再拼接字符串或查表；文件变化时随缓存项一起失效
+ * - 内存中的小文件的响应头之后紧接文件内容，返回的就是完整响应，extents() 为空，一次 write 发出
+ * - 通过 FileCache 获取已映射的文件，响应发送完之前持有其引用，文件失效后映射仍然有效
+ * - 200 响应带 ETag 与 Last-Modified；If-None-Match（优先）或 If-Modified-Since 命中时返回不带正文的 304
+ * - 200/304 响应按 MIME 类型附带 Cache-Control: max-age（由 config.json 的 cache_max_age 配置）
+ * - Range：单个区间返回 206 与 Content-Range，多个区间返回 multipart/byteranges，不可满足时返回 416；
+ *   If-Range 不匹配时忽略 Range。只发送请求的区间（内存映射中的对应部分或 sendfile 的偏移），不发送整个文件
+ * - 预压缩：Accept-Encoding 接受 br 或 gzip 且 FileCache 中有对应的兄弟文件时发送它（br 优先），
+ *   带 Content-Encoding；有兄弟文件的资源的响应都带 Vary: Accept-Encoding。验证器与 Range 针对实际发送的版本
+ * - 动态压缩：没有预压缩文件的可压缩类型（文本、脚本、XML/JSON/SVG）由 GzipCache 在线程池中压缩并缓存，
+ *   压缩完成之前发送原文件，之后的请求发送缓存的结果
+ * - 支持 200、206、304、400、403、404、416 等常见 HTTP 状态码
  *
  * 使用说明：
  * 1. 调用 Init 设置响应参数（目录、路径、是否长连接、状态码）。
- * 2. 调用 make_Response 生成响应内容到 Buffer。
+ * 2. 调用 make_Response 生成响应：先发送返回的响应头（不为 nullptr 时），再按 extents() 依次发送
+ *    Buffer 中的 Prefix 字节与文件区间，最后发送 Buffer 中剩余的字节。
  * 3. 通过 file() 和 file_Length() 获取文件内容用于高效发送。
  *
  * 依赖：
  * - C++ STL
- * - Linux 系统调用（stat, open, mmap, munmap 等）
+ * - FileCache 类（打开文件与元数据缓存）
+ * - MimeTable 与 StatusTable（http_tables.h）
  * - Buffer 类用于数据写入
  *
  * 路径：webserve/src/HttpResponse.cpp
  */
 #pragma once
 #include <unordered_map>
-#include <fcntl.h>  //open
-#include <unistd.h> //close
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
 #include <sys/stat.h> //stat
-#include <sys/mman.h> //mmap,munmap
 #include <assert.h>
 #include "buffer.h"
+#include "file_cache.h"
+#include "gzip_cache.h"
+#include "http_tables.h"
 class HttpResponse{
+    public:
+    //请求中影响响应的头，没有时为空
+    struct Conditions{
+        std::string_view If_None_Match;
+        std::string_view If_Modified_Since;
+        std::string_view Range;
+        std::string_view If_Range;
+        std::string_view Accept_Encoding;
+    };
+    //一段需要发送的文件内容：先发送写入Buffer的Prefix字节（多段响应的分段头），再发送文件的[Offset,Offset+Length)
+    struct Extent{
+        size_t Prefix;
+        off_t Offset;
+        size_t Length;
+    };
+
     private:
     //HTTP响应状态码
     int code_;
@@ -57,43 +103,83 @@ class HttpResponse{
     //资源目录
     std::string srcDir_;
     
-    //内存映射的文件指针
-    char* mmFile_;
-    //文件状态信息，系统结构体，包含了文件的各种属性，如大小、权限、时间戳等
-    struct stat mmFileStat_;
+    //请求的条件头、Range与Accept-Encoding：指向读缓冲区中请求的视图，只在make_Response中使用
+    //（请求在生成响应之前不会被覆盖），不拷贝
+    Conditions conditions_;
+    //需要发送的文件区间
+    std::vector<Extent> extents_;
+    //206/416响应的Content-Range与多段响应的分隔符，其余响应为空
+    std::string content_range_;
+    std::string boundary_;
+    //一个请求最多的区间数，超过时忽略Range
+    static const size_t MAX_RANGES_=16;
+
+    //缓存中的文件（描述符、状态信息与内存映射），持有引用直到响应发送完
+    std::shared_ptr<const FileCache::File> file_;
     
-    //文件后缀与MIME类型的映射
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    //状态码与状态信息的映射
-    static const std::unordered_map<int, std::string> CODE_STATUS;
-    //状态码与错误页面路径的映射
-    static const std::unordered_map<int, std::string> CODE_PATH;
+    //当前使用的后缀与MIME类型的完美哈希表：编译期生成的内置表，或启动时加上配置的类型重新生成的表
+    static const MimeTable* MIME_;
+    //启动时重新生成的表与其表项引用的字符串
+    static std::unique_ptr<MimeTable> CUSTOM_MIME_;
+    static std::vector<std::string> MIME_STRINGS_;
+    //MIME类型与Cache-Control max-age（秒）的映射，"*"为其余类型的默认值，没有配置时不发送Cache-Control
+    static std::unordered_map<std::string, int> MAX_AGE;
     
-    //添加状态行到缓冲区
-    void add_State_Line_(Buffer& buffer);
-    //添加响应头到缓冲区
-    void add_Response_Header_(Buffer& buffer);
-    //添加响应内容到缓冲区
-    void add_Response_Content_(Buffer& buffer);
+    //Accept-Encoding是否接受内容编码Coding（q不为0）
+    bool accepts_Encoding_(std::string_view Coding) const;
+    //按Accept-Encoding选用文件的预压缩或动态压缩版本
+    void negotiate_Encoding_();
+    //MIME类型Type是否值得压缩
+    static bool compressible_Type_(std::string_view Type);
+    //响应是否随Accept-Encoding变化（需要Vary）
+    bool varies_();
+    //请求的条件头表明客户端的副本仍然有效
+    bool not_Modified_() const;
+    //解析Range得到的区间（按请求顺序），没有Range或应忽略时返回false；不可满足时返回true且Ranges为空
+    bool parse_Range_(std::vector<std::pair<off_t,size_t>>& Ranges) const;
+    //生成206/416响应写入buffer
+    void range_Content_(Buffer& buffer,const std::vector<std::pair<off_t,size_t>>& Ranges);
+    //预先生成的响应头在缓存项中的槽位（状态码与是否保持连接）
+    size_t header_Slot_() const;
+    //生成状态行与响应头（到空行为止），正文长度为Content_Length
+    std::string render_Header_(size_t Content_Length);
 
     //生成错误HTML页面
     void errorHTML_();
-    //获取文件类型
-    std::string get_File_Type();
+    //请求路径的后缀对应的MIME表项，没有时为text/plain
+    const MimeTable::Entry& mime_Entry_() const;
+    //获取文件类型（MIME表中的视图，不分配内存）
+    std::string_view get_File_Type() const;
 
     public:
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std::string& srcDir,std::string& path_,bool Are_You_Keep_Alive=false,int code=-1);
-    //生成HTTP响应
-    void make_Response(Buffer& buffer);
-    //解除文件映射
+    void Init(const std::string& srcDir,std::string_view path,bool Are_You_Keep_Alive=false,int code=-1,
+              const Conditions& conditions=Conditions());
+    //按MIME类型设置Cache-Control的max-age（秒），"*"为默认值
+    static void set_Cache_Control(const std::unordered_map<std::string,int>& Max_Age);
+    //在内置的MIME类型之外增加或覆盖后缀（如".svg"->"image/svg+xml"），重新生成完美哈希表，返回表项数；
+    //只在启动时、开始服务之前调用，配置无效（含同一后缀的不同写法配置了不同的类型）时抛出std::invalid_argument
+    static size_t set_Mime_Types(const std::unordered_map<std::string,std::string>& Types);
+    //生成HTTP响应：返回缓存项中预先生成的响应头（小文件为完整响应），否则把响应头（与分段头、错误页面）写入buffer并返回nullptr
+    const std::string* make_Response(Buffer& buffer);
+    //释放对缓存文件的引用
     void unmap_File();
     //获取映射文件的指针
     char* file();
-    //获取文件长度
+    //获取需要发送的文件长度，304时为0
     size_t file_Length() const;
+    //获取文件描述符，没有时为-1
+    int file_Fd() const;
+    //获取缓存文件的引用，输出队列持有它直到文件内容发送完
+    std::shared_ptr<const FileCache::File> file_Ref() const{
+        return file_;
+    }
+    //需要发送的文件区间
+    const std::vector<Extent>& extents() const{
+        return extents_;
+    }
     //生成错误响应内容
     void error_Content(Buffer& buffer,std::string message);
     //获取响应状态码
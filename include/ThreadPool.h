@@ -4,8 +4,19 @@
 #include <future>
 #include <coroutine>
 #include <atomic>
+#include <functional>
+#include <mutex>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <unordered_map>
-#include "concurrentqueue.h"  // Requires the concurrentqueue library
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 class CoroutineThreadPool {
 public:
@@ -19,20 +30,37 @@ public:
         };
     };
 
-    explicit CoroutineThreadPool(size_t threads, size_t max_coroutines_per_thread = 100) 
+    explicit CoroutineThreadPool(size_t threads, size_t max_coroutines_per_thread = 100)
         : m_max_coroutines(max_coroutines_per_thread),
-          m_stop(false) {
+          m_stop(false),
+          m_workers(new Worker[threads]),
+          m_worker_count(threads),
+          m_inject(new InjectCell[kInjectCapacity]),
+          m_spin(std::thread::hardware_concurrency() > 1) {
+        for (size_t i = 0; i < kInjectCapacity; ++i) {
+            m_inject[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            m_workers[i].rng = static_cast<uint32_t>(i * 2654435761u) | 1;
+        }
         for (size_t i = 0; i < threads; ++i) {
-            m_threads.emplace_back([this] { worker_loop(); });
+            m_threads.emplace_back([this, i] { worker_loop(i); });
         }
     }
 
     ~CoroutineThreadPool() {
         m_stop = true;
-        m_cv.notify_all();
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(INT_MAX);
         for (auto& t : m_threads) {
             if (t.joinable()) t.join();
         }
+        // Destroy tasks that never ran
+        Task task;
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            while (m_workers[i].deque.pop(task)) task.op(task.storage, false);
+        }
+        while (take_injected(task)) task.op(task.storage, false);
     }
 
     template<typename F, typename... Args>
@@ -43,33 +71,323 @@ public:
             std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
         auto res = task->get_future();
-        
-        // Using lock-free queue
-        m_tasks.enqueue([this, task]() -> CoroutineTask {
+
+        auto coroutine = [this, task]() -> CoroutineTask {
             // Thread-local state tracking
             auto& local_state = get_thread_state();
             local_state.active_coroutines++;
-            
+
             try {
                 (*task)(); // Execute the actual task
             } catch (...) {
                 local_state.active_coroutines--;
                 throw;
             }
-            
+
             local_state.active_coroutines--;
             co_return;
-        });
-        
-        m_cv.notify_one();
+        };
+        post([coroutine] { coroutine(); });
         return res;
     }
 
+    // Bytes available for a posted callable inside one task
+    static constexpr size_t kPostStorage = 48;
+
+    // Fire-and-forget. Trivially copyable callables up to kPostStorage bytes (such as a
+    // lambda capturing a few pointers) are stored inline, so posting them never allocates;
+    // anything else is boxed on the heap. Called from a worker, the task goes to that
+    // worker's own deque, otherwise to the shared injection ring. Exceptions escaping the
+    // callable terminate.
+    template<typename F>
+    void post(F&& f) {
+        Task task;
+        make_task(task, std::forward<F>(f));
+        Worker* self = t_pool == this ? &m_workers[t_worker] : nullptr;
+        if (self && self->deque.push(task)) {
+            wake_one();
+            return;
+        }
+        while (!inject(task)) {
+            if (self) {
+                // Both queues are full: run it here instead of waiting for ourselves
+                task.op(task.storage, true);
+                return;
+            }
+            std::this_thread::yield();
+        }
+        wake_one();
+    }
+
 private:
+    // A posted callable together with the function that runs (optionally) and destroys it
+    struct Task {
+        void (*op)(void*, bool run);
+        alignas(std::max_align_t) unsigned char storage[kPostStorage];
+    };
+    static_assert(std::is_trivially_copyable_v<Task>, "tasks are relocated with memcpy");
+
+    // Queue element: the bytes of a Task as relaxed atomic words, so a thief may read a
+    // cell the owner is reusing without a data race (its CAS on top then discards the copy)
+    static constexpr size_t kTaskWords = (sizeof(Task) + 7) / 8;
+    struct TaskCell {
+        std::atomic<uint64_t> words[kTaskWords];
+
+        void store(const Task& task) {
+            uint64_t raw[kTaskWords] = {};
+            std::memcpy(raw, &task, sizeof(Task));
+            for (size_t i = 0; i < kTaskWords; ++i) words[i].store(raw[i], std::memory_order_relaxed);
+        }
+        void load(Task& task) const {
+            uint64_t raw[kTaskWords];
+            for (size_t i = 0; i < kTaskWords; ++i) raw[i] = words[i].load(std::memory_order_relaxed);
+            std::memcpy(&task, raw, sizeof(Task));
+        }
+    };
+
+    // Fixed-size Chase-Lev deque: the owner pushes and pops at the bottom, thieves steal
+    // from the top. It never grows, so no buffer is ever reclaimed under a thief.
+    class WorkDeque {
+    public:
+        static constexpr int64_t kCapacity = 1024;
+
+        bool push(const Task& task) {
+            int64_t b = m_bottom.load(std::memory_order_relaxed);
+            int64_t t = m_top.load(std::memory_order_acquire);
+            if (b - t >= kCapacity) return false;
+            m_cells[b & (kCapacity - 1)].store(task);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+        bool pop(Task& task) {
+            int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = m_top.load(std::memory_order_relaxed);
+            if (t > b) {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            m_cells[b & (kCapacity - 1)].load(task);
+            if (t == b) {
+                // Last task: race the thieves for it
+                bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                         std::memory_order_relaxed);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+        bool steal(Task& task) {
+            int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = m_bottom.load(std::memory_order_acquire);
+            if (t >= b) return false;
+            m_cells[t & (kCapacity - 1)].load(task);
+            return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed);
+        }
+        bool empty() const {
+            return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed);
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> m_top{0};
+        alignas(64) std::atomic<int64_t> m_bottom{0};
+        std::unique_ptr<TaskCell[]> m_cells{new TaskCell[kCapacity]};
+    };
+
+    struct alignas(64) Worker {
+        WorkDeque deque;
+        uint32_t rng = 1;  // xorshift state for picking steal victims
+    };
+
+    // Bounded MPMC ring (Vyukov) for tasks posted from outside the pool
+    static constexpr size_t kInjectCapacity = 4096;
+    struct alignas(64) InjectCell {
+        std::atomic<size_t> sequence;
+        TaskCell task;
+    };
+
+    // Most tasks a worker moves from the injection ring at once
+    static constexpr size_t kInjectBatch = 16;
+    // Bounded spinning before parking: pause iterations, then yields. Skipped on a single
+    // CPU, where spinning only delays the thread that would produce the work.
+    static constexpr int kSpinPause = 64;
+    static constexpr int kSpinYield = 4;
+
     struct ThreadState {
         std::atomic<size_t> active_coroutines{0};
     };
 
+    template<typename F>
+    static void make_task(Task& task, F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= kPostStorage && alignof(Fn) <= alignof(std::max_align_t)
+                      && std::is_trivially_copyable_v<Fn>) {
+            new (task.storage) Fn(std::forward<F>(f));
+            task.op = [](void* p, bool run) {
+                if (run) (*std::launder(static_cast<Fn*>(p)))();
+            };
+        } else {
+            Fn* boxed = new Fn(std::forward<F>(f));
+            std::memcpy(task.storage, &boxed, sizeof(boxed));
+            task.op = [](void* p, bool run) {
+                Fn* fn;
+                std::memcpy(&fn, p, sizeof(fn));
+                std::unique_ptr<Fn> owner(fn);
+                if (run) (*fn)();
+            };
+        }
+    }
+
+    bool inject(const Task& task) {
+        size_t pos = m_inject_tail.load(std::memory_order_relaxed);
+        InjectCell* cell;
+        for (;;) {
+            cell = &m_inject[pos & (kInjectCapacity - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_inject_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // Full: the cell still holds a task from the previous lap
+            } else {
+                pos = m_inject_tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->task.store(task);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Claims up to max published tasks from the injection ring with one CAS; returns the count
+    size_t claim_injected(size_t max, size_t& first) {
+        size_t pos = m_inject_head.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t n = 0;
+            while (n < max) {
+                size_t seq = m_inject[(pos + n) & (kInjectCapacity - 1)].sequence.load(std::memory_order_acquire);
+                if (seq != pos + n + 1) break;
+                ++n;
+            }
+            if (n == 0) {
+                size_t now = m_inject_head.load(std::memory_order_relaxed);
+                if (now == pos) return 0;
+                pos = now;
+                continue;
+            }
+            if (m_inject_head.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                first = pos;
+                return n;
+            }
+        }
+    }
+
+    // Copies a claimed task out and hands its cell back to producers
+    void release_injected(size_t pos, Task& task) {
+        InjectCell& cell = m_inject[pos & (kInjectCapacity - 1)];
+        cell.task.load(task);
+        cell.sequence.store(pos + kInjectCapacity, std::memory_order_release);
+    }
+
+    bool take_injected(Task& task) {
+        size_t first;
+        if (claim_injected(1, first) == 0) return false;
+        release_injected(first, task);
+        return true;
+    }
+
+    // Takes one task from the injection ring and moves a share of the rest to our deque,
+    // where idle workers steal them instead of all contending on the ring's head
+    bool take_injected_batch(Worker& self, Task& task) {
+        size_t pending = m_inject_tail.load(std::memory_order_relaxed)
+                       - m_inject_head.load(std::memory_order_relaxed);
+        size_t want = pending / m_worker_count + 1;
+        if (want > kInjectBatch) want = kInjectBatch;
+        size_t first;
+        size_t n = claim_injected(want, first);
+        if (n == 0) return false;
+        // Pushed newest first, so that our own LIFO pops still run them in posting order
+        for (size_t i = n; i-- > 1;) {
+            Task extra;
+            release_injected(first + i, extra);
+            if (!self.deque.push(extra)) extra.op(extra.storage, true);
+        }
+        release_injected(first, task);
+        if (n > 1) wake_one();
+        return true;
+    }
+
+    // Tries every other worker once, starting from a random victim
+    bool steal(Worker& self, size_t index, Task& task) {
+        if (m_worker_count < 2) return false;
+        self.rng ^= self.rng << 13;
+        self.rng ^= self.rng >> 17;
+        self.rng ^= self.rng << 5;
+        size_t start = self.rng % m_worker_count;
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            size_t victim = (start + i) % m_worker_count;
+            if (victim != index && m_workers[victim].deque.steal(task)) return true;
+        }
+        return false;
+    }
+
+    bool has_pending() const {
+        if (m_inject_tail.load(std::memory_order_relaxed) != m_inject_head.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            if (!m_workers[i].deque.empty()) return true;
+        }
+        return false;
+    }
+
+    void futex_wait(uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAIT_PRIVATE, expected,
+                nullptr, nullptr, 0);
+    }
+    long futex_wake(int count) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAKE_PRIVATE, count,
+                       nullptr, nullptr, 0);
+    }
+
+    // Only makes a system call when some worker is parked and no wake-up is already on its
+    // way; a woken worker that finds more work wakes the next one itself
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_relaxed) > 0 && !m_notified.exchange(true)) {
+            m_epoch.fetch_add(1, std::memory_order_release);
+            if (futex_wake(1) == 0) {
+                // Nobody was asleep yet: whoever is parking re-checks the queues
+                m_notified.exchange(false);
+            }
+        }
+    }
+
+    // Sleeps until wake_one() bumps the epoch. The sleeper is announced and the epoch read
+    // before re-checking the queues, which pairs with the fence in wake_one().
+    void park() {
+        m_sleepers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t epoch = m_epoch.load(std::memory_order_acquire);
+        if (!m_stop && !has_pending()) {
+            futex_wait(epoch);
+        }
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        // Synchronizes with posts that skipped the wake-up while it was pending
+        m_notified.exchange(false);
+    }
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
     ThreadState& get_thread_state() {
         static thread_local ThreadState* state = nullptr;
         if (!state) {
@@ -80,15 +398,26 @@ private:
         return *state;
     }
 
-    void worker_loop() {
+    void worker_loop(size_t index) {
         // Initialize thread-local state
         get_thread_state();
+        t_pool = this;
+        t_worker = index;
+        Worker& self = m_workers[index];
 
+        int idle = 0;
+        bool woken = false;
         while (!m_stop) {
-            // Try to dequeue a task without blocking first
-            std::function<CoroutineTask()> task;
-            if (m_tasks.try_dequeue(task)) {
-                task(); // Execute the coroutine task
+            // Own deque first, then the injection ring, then the other workers
+            Task task;
+            if (self.deque.pop(task) || take_injected_batch(self, task) || steal(self, index, task)) {
+                if (woken) {
+                    // Pass the wake-up on if there is more than we can take
+                    woken = false;
+                    if (has_pending()) wake_one();
+                }
+                task.op(task.storage, true);
+                idle = 0;
                 continue;
             }
 
@@ -99,31 +428,47 @@ private:
                 continue;
             }
 
-            // Wait for a task with a timeout to periodically check m_stop
-            std::unique_lock<std::mutex> lock(m_cv_mutex);
-            m_cv.wait_for(lock, std::chrono::milliseconds(100), [&] {
-                return m_stop || m_tasks.try_dequeue(task);
-            });
-
-            if (m_stop) return;
-            if (task) {
-                task();
+            // Spin a little before paying for a futex sleep and wake-up
+            ++idle;
+            if (m_spin && idle <= kSpinPause) {
+                cpu_relax();
+            } else if (m_spin && idle <= kSpinPause + kSpinYield) {
+                std::this_thread::yield();
+            } else {
+                park();
+                idle = 0;
+                woken = true;
             }
         }
+        t_pool = nullptr;
     }
 
+    // The pool and worker index of the current thread, if it is a worker
+    static inline thread_local CoroutineThreadPool* t_pool = nullptr;
+    static inline thread_local size_t t_worker = 0;
+
     const size_t m_max_coroutines;
     std::atomic<bool> m_stop;
     std::vector<std::thread> m_threads;
-    
-    // Lock-free queue for task storage
-    moodycamel::ConcurrentQueue<std::function<CoroutineTask()>> m_tasks;
-    
+
+    // Per-worker deques
+    std::unique_ptr<Worker[]> m_workers;
+    const size_t m_worker_count;
+
+    // Injection ring for tasks posted from outside the pool
+    std::unique_ptr<InjectCell[]> m_inject;
+    const bool m_spin;
+    alignas(64) std::atomic<size_t> m_inject_tail{0};
+    alignas(64) std::atomic<size_t> m_inject_head{0};
+
+    // Parking: futex word bumped on every wake-up, the number of parked workers and
+    // whether a wake-up has been sent that no worker has picked up yet
+    alignas(64) std::atomic<uint32_t> m_epoch{0};
+    std::atomic<size_t> m_sleepers{0};
+    std::atomic<bool> m_notified{false};
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
     // Thread state management
     std::mutex m_state_mutex;
     std::unordered_map<std::thread::id, ThreadState> m_thread_states;
-    
-    // Condition variable for worker synchronization
-    std::mutex m_cv_mutex;
-    std::condition_variable m_cv;
-};
\ No newline at end of file
+};
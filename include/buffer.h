@@ -4,13 +4,18 @@
  *
  * 主要功能：
  * - 管理内部缓冲区，实现高效的读写操作
- * - 自动扩容与空间复用，避免频繁分配内存
+ * - 自动扩容与空间复用，避免频繁分配内存；存储块来自按大小分级的 BufferPool
+ * - 存储块按需借用：构造时不分配，第一次写入时才从池中取得，Release 在缓冲区为空时把块还给池
+ * - Init_Buffer 为 O(1)，只重置读写位置，不清零内容
  * - 支持与文件描述符的数据读写（readv/write）
  * - 提供便捷的字符串与二进制数据接口
  *
  * 类 Buffer 提供如下接口：
- *   Buffer(int initBuffersize)                 // 构造函数，指定初始缓冲区大小
- *   void Init_Buffer()                         // 重置缓冲区内容和指针
+ *   Buffer(int initBuffersize)                 // 构造函数，指定初始缓冲区大小（默认 0，第一次写入时再借用）
+ *   void Init_Buffer()                         // 重置读写指针（O(1)，不清零内容）
+ *   bool Release()                             // 缓冲区为空时把存储块还给池，返回是否归还
+ *   void Swap(Buffer& Other)                   // 交换两个缓冲区的存储块与读写位置（存储块的地址不变）
+ *   size_t Capacity() const                    // 当前借用的容量，空闲时为 0
  *   void Write_to_Buffer(const char*, size_t)  // 写入数据到缓冲区
  *   void Write_to_Buffer(const std::string&)   // 写入字符串到缓冲区
  *   void Write_to_Buffer(const void*, size_t)  // 写入任意数据到缓冲区
@@ -19,33 +24,53 @@
  *   ssize_t Put_Data(int fd, int* Errno)       // 向文件描述符写入数据
  *   std::string Get_All_Data_String()          // 获取所有未读数据并清空缓冲区
  *
+ *   void Take_Ownership()                      // 当前线程接管缓冲区
+ *
+ * 线程模型：
+ * - Buffer 只属于一个线程，读写位置是普通整数，没有原子操作与内存屏障
+ * - 连接在 Reactor 线程与工作线程之间移动时，由接手的线程调用 Take_Ownership 显式接管；
+ *   交接本身的同步由投递任务的队列（release/acquire）或 epoll 重新注册提供
+ * - 未定义 NDEBUG 时，修改缓冲区的接口会断言调用者是当前所有者
+ *
  * 使用说明：
- * 1. 创建 Buffer 对象，指定初始大小。
+ * 1. 创建 Buffer 对象（可以指定初始大小）。
  * 2. 使用 Write_to_Buffer 写入数据，或 Get_Data 从 fd 读取。
  * 3. 使用 Put_Data 写出数据，或 Get_All_Data_String 获取全部内容。
  *
  * 依赖：
- * - cstring, vector, string, unistd.h, sys/uio.h
+ * - cstring, string, unistd.h, sys/uio.h
+ * - buffer_pool.h
  *
  * 路径：webserve/src/buffer.cpp
  */
 
 #pragma once
-#include<vector>
+#include"buffer_pool.h"
 #include<iostream>
 #include<cstring>
-#include<atomic>
+#include<thread>
 #include<unistd.h> //read() write()
 #include<sys/uio.h> //readv() writev()
 #include<assert.h>
 class Buffer{
     private:
-    //缓冲区实体(数据)
-    std::vector<char>buffer_;
+    //缓冲区实体(数据)与容量，存储块来自BufferPool
+    char* Data_;
+    size_t Capacity_;
     //“读指针”(读位置在缓冲区实体内部的正整数索引)
-    std::atomic<size_t>ReadPos_;
+    size_t ReadPos_;
     //“写指针”(写位置在缓冲区实体内部的正整数索引)
-    std::atomic<size_t>WritePos_;
+    size_t WritePos_;
+#ifndef NDEBUG
+    //当前所有者线程，仅用于断言
+    std::thread::id Owner_;
+#endif
+    //断言调用者是当前所有者
+    void Check_Owner_() const{
+#ifndef NDEBUG
+        assert(Owner_==std::this_thread::get_id());
+#endif
+    }
     //获得缓冲区的起始位置
     char* BeginPtr_();
     //获得缓冲区的起始位置(只读)
@@ -54,10 +79,27 @@ class Buffer{
     void We_Should_Be_Enough_(size_t Length_We_Need);
     
     public:
-    //在创建一个缓存区对象时需指定初始大小(默认1024)
-    Buffer(int InitBufferSpace=1024);
-    //初始化当前缓存区(包括内容、读写指针位置)
+    //在创建一个缓存区对象时可指定初始大小(默认0：不占用存储，第一次写入时再借用)
+    Buffer(int InitBufferSpace=0);
+    ~Buffer();
+    Buffer(const Buffer&)=delete;
+    Buffer& operator=(const Buffer&)=delete;
+    //初始化当前缓存区(读写指针位置)，不清零内容
     void Init_Buffer();
+    //缓冲区为空时把存储块还给池，之后不再占用存储，返回是否归还
+    bool Release();
+    //交换存储块与读写位置，指向存储块的指针仍然有效
+    void Swap(Buffer& Other);
+    //当前借用的容量，空闲时为0
+    size_t Capacity() const{
+        return Capacity_;
+    }
+    //当前线程接管缓冲区，之后只有它可以修改
+    void Take_Ownership(){
+#ifndef NDEBUG
+        Owner_=std::this_thread::get_id();
+#endif
+    }
 
     //返回现有缓存区未写入数据的字节数
     size_t How_Many_Bytes_Can_We_Write() const;
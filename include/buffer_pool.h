@@ -0,0 +1,87 @@
+/*
+ * @buffer_pool.cpp
+ * ----------------
+ * 这是 Buffer 存储块的按大小分级缓存池的实现文件，连接之间共享存储块。
+ *
+ * 主要功能：
+ * - 存储块分为 4KB、16KB、64KB 三级，申请时向上取整到所在级别，更大的块直接 malloc/free
+ * - 每个线程一个池（thread_local）：多 Reactor 模式下即每个 Reactor 一个池，申请与归还都不加锁；
+ *   块可以在任意线程归还，进入该线程的池
+ * - 连接只在有数据收发时借用存储块，空闲时归还（见 Buffer::Release），空闲的长连接不占用缓冲区内存
+ * - 每级缓存的字节数有上限，超出的块直接释放
+ * - 统计当前线程池的缓存量与命中情况
+ *
+ * 类 BufferPool 提供如下接口：
+ *   static char* Allocate(size_t& Capacity)          // 申请不小于 Capacity 的块，Capacity 改为块的实际大小
+ *   static void Deallocate(char* Data,size_t Capacity) // 归还 Allocate 得到的块
+ *   static size_t Round_Up(size_t Size)              // Size 所在级别的块大小
+ *   static Stats Local_Stats()                       // 当前线程池的统计
+ *
+ * 使用说明：
+ * 1. Buffer 的存储全部通过 Allocate/Deallocate 获得与归还。
+ * 2. HttpConnection 在请求处理完、响应写完后调用 Buffer::Release 把块还给池。
+ *
+ * 依赖：
+ * - cstdlib (malloc, free)
+ *
+ * 路径：webserve/src/buffer_pool.cpp
+ */
+#pragma once
+#include<stddef.h>
+#include<cstdlib>
+#include<new>
+
+class BufferPool{
+    public:
+    //当前线程池的统计
+    struct Stats{
+        //池中缓存的块数与字节数
+        size_t Cached_Blocks;
+        size_t Cached_Bytes;
+        //从池中取得的次数、向malloc申请的次数
+        size_t Hits;
+        size_t Misses;
+    };
+
+    private:
+    //最小级别的块大小、相邻级别的倍数(4的幂)与级别数：4KB,16KB,64KB
+    static const size_t MIN_CLASS_SIZE_=4096;
+    static const size_t CLASS_SHIFT_=2;
+    static const size_t CLASS_COUNT_=3;
+    //每级最多缓存的字节数
+    static const size_t MAX_CACHED_BYTES_=2*1024*1024;
+    //每级最多缓存的块数
+    static const size_t MAX_CACHED_BLOCKS_=MAX_CACHED_BYTES_/MIN_CLASS_SIZE_;
+
+    //一个级别的空闲块（栈）
+    struct Class_{
+        char* Free[MAX_CACHED_BLOCKS_];
+        size_t Count;
+    };
+    Class_ Classes_[CLASS_COUNT_];
+    size_t Hits_;
+    size_t Misses_;
+
+    BufferPool();
+    ~BufferPool();
+    //当前线程的池，线程退出后返回nullptr
+    static BufferPool* Local_();
+    //Size所在级别，超出最大级别时返回CLASS_COUNT_
+    static size_t Class_Of_(size_t Size);
+    //第Index级的块大小
+    static size_t Class_Size_(size_t Index){
+        return MIN_CLASS_SIZE_<<(Index*CLASS_SHIFT_);
+    }
+
+    public:
+    BufferPool(const BufferPool&)=delete;
+    BufferPool& operator=(const BufferPool&)=delete;
+    //申请不小于Capacity的块，Capacity改为块的实际大小
+    static char* Allocate(size_t& Capacity);
+    //归还Allocate得到的块
+    static void Deallocate(char* Data,size_t Capacity);
+    //Size所在级别的块大小，超出最大级别时原样返回
+    static size_t Round_Up(size_t Size);
+    //当前线程池的统计
+    static Stats Local_Stats();
+};
@@ -0,0 +1,85 @@
+/*
+ * @connection_slab.cpp
+ * --------------------
+ * 这是按文件描述符索引的连接表的实现文件，替代 std::unordered_map<int,HttpConnection>。
+ *
+ * 主要功能：
+ * - 一次性预留 Capacity 个槽位（匿名 mmap，只有被访问过的页才占用物理内存），按描述符直接下标访问，没有哈希查找
+ * - 每个槽位按缓存行对齐，不同描述符的连接不会共享缓存行
+ * - 槽位地址在整个生命周期内不变，不会因扩容或重新哈希而移动，线程池与定时器持有的 HttpConnection* 始终有效
+ * - 槽位中的 HttpConnection 第一次使用时构造，之后在描述符复用时重复使用（缓冲区存储块只在有数据收发时借用，不随槽位保留）
+ *
+ * 类 ConnectionSlab 提供如下接口：
+ *   explicit ConnectionSlab(size_t Capacity)   // 预留 Capacity 个槽位，描述符须小于 Capacity
+ *   HttpConnection* Get(int fd)                // 获取描述符对应的连接，必要时构造；超出容量时返回 nullptr
+ *   HttpConnection* Find(int fd) const         // 获取已构造的连接，不存在时返回 nullptr
+ *   size_t Capacity() const                    // 槽位数量
+ *   static size_t Default_Capacity(size_t Max) // RLIMIT_NOFILE 与 Max 中较小者
+ *
+ * 使用说明：
+ * 1. Reactor 创建时按 Default_Capacity 构造连接表。
+ * 2. 新连接用 Get 取得槽位，事件到来时用 Find 取得连接。
+ *
+ * 依赖：
+ * - HttpConnection 类
+ * - Linux 系统调用（mmap, munmap, getrlimit）
+ *
+ * 路径：webserve/src/connection_slab.cpp
+ */
+#pragma once
+#include"HttpConnection.h"
+#include<stddef.h>
+#include<new>
+#include<sys/mman.h> //mmap,munmap
+#include<sys/resource.h> //getrlimit
+
+class ConnectionSlab{
+    private:
+    //缓存行大小
+    static const size_t CACHE_LINE_=64;
+    //一个槽位：连接对象的存储与是否已构造
+    struct alignas(CACHE_LINE_) Slot_{
+        alignas(HttpConnection) unsigned char Storage[sizeof(HttpConnection)];
+        bool Constructed;
+    };
+
+    //槽位数组（匿名映射，初始全为0，即全部未构造）
+    Slot_* Slots_;
+    size_t Capacity_;
+
+    static HttpConnection* connection_(Slot_& Slot){
+        return std::launder(reinterpret_cast<HttpConnection*>(Slot.Storage));
+    }
+
+    public:
+    explicit ConnectionSlab(size_t Capacity);
+    ~ConnectionSlab();
+    ConnectionSlab(const ConnectionSlab&)=delete;
+    ConnectionSlab& operator=(const ConnectionSlab&)=delete;
+
+    //获取描述符对应的连接，第一次使用时构造，超出容量时返回nullptr
+    HttpConnection* Get(int FileD){
+        if(FileD<0||static_cast<size_t>(FileD)>=Capacity_){
+            return nullptr;
+        }
+        Slot_& slot=Slots_[FileD];
+        if(!slot.Constructed){
+            new(slot.Storage) HttpConnection();
+            slot.Constructed=true;
+        }
+        return connection_(slot);
+    }
+    //获取已构造的连接，不存在时返回nullptr
+    HttpConnection* Find(int FileD) const{
+        if(FileD<0||static_cast<size_t>(FileD)>=Capacity_||!Slots_[FileD].Constructed){
+            return nullptr;
+        }
+        return connection_(Slots_[FileD]);
+    }
+    //槽位数量
+    size_t Capacity() const{
+        return Capacity_;
+    }
+    //进程可打开的描述符数量与Max中较小者
+    static size_t Default_Capacity(size_t Max);
+};
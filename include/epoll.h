@@ -2,6 +2,7 @@
  * @epoll.cpp
  * -----------
  * 这是一个基于 epoll 的事件管理类实现文件，适用于高性能网络服务器的 IO 多路复用。
+ * Epoller 是 EventBackend 的就绪式实现。
  *
  * 主要功能：
  * - 创建和管理 epoll 实例
@@ -25,11 +26,13 @@
  *
  * 依赖：
  * - epoll.h 头文件
+ * - event_backend.h 事件后端接口
  * - Linux epoll API
  *
  * 路径：webserve/src/epoll.cpp
  */
 #pragma once
+#include"event_backend.h"
 #include<sys/epoll.h> //epoll_ctl()
 #include<fcntl.h> //fcntl()
 #include<unistd.h> //close()
@@ -37,7 +40,7 @@
 #include<vector>
 #include<errno.h>
 
-class Epoller{
+class Epoller:public EventBackend{
     private:
     //Epoll描述符，能管理多个文件描述符，同时监听这些事件，通过epoll_create函数来产生
     int EpollerFd_;
@@ -55,20 +58,20 @@ class Epoller{
     std::vector<epoll_event>Events_;
 
     public:
-    ~Epoller();
+    ~Epoller() override;
     //使用 explicit 构造函数避免意外的类型转换(隐式类型转换),创建Epoller时接受一个整型来指示最大事件数量
     explicit Epoller(int MaxEvent=1024);
     //将文件描述符Filed的Events动作加入Epoll监控(Events可以包含一个或多个事件标志)
-    bool AddFd(int FileD,uint32_t Events);
+    bool AddFd(int FileD,uint32_t Events) override;
     //修改描述符FileD对应的事件
-    bool ModFd(int FileD,uint32_t Events);
+    bool ModFd(int FileD,uint32_t Events) override;
     //移除对描述符FileD的监控
-    bool DelFd(int FileD);
+    bool DelFd(int FileD) override;
     //使用epoll_wait()等待直到文件描述符上发生指定的事件或超时
     //获得事件对应的描述符(Events_[Index].data.fd)，输入参数表示指定事件在Events_中的索引
-    int Get_Event_FileD(size_t Index) const;
+    int Get_Event_FileD(size_t Index) const override;
     //获得事件对应的类型(Events_[Index].events)
-    uint32_t Get_Event_events(size_t Index) const;
+    uint32_t Get_Event_events(size_t Index) const override;
 
-    int Wait(int timeoutMs);
+    int Wait(int timeoutMs) override;
 };
\ No newline at end of file
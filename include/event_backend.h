@@ -0,0 +1,80 @@
+/*
+ * @event_backend.h
+ * ----------------
+ * 这是 Reactor 事件后端的抽象接口，Epoller（epoll）与 UringPoller（io_uring）是它的两种实现。
+ *
+ * 两类后端：
+ * - 就绪式（epoll）：Wait 返回“某个描述符可读/可写”，由 Reactor 自己调用 readv/writev 完成 IO，
+ *   使用 EPOLLONESHOT 时每次处理完需要 ModFd 重新注册
+ * - 完成式（io_uring）：Wait 返回“某个 IO 已经完成”。监听套接字返回新连接的描述符，
+ *   连接套接字返回已接收的数据（Get_Event_Data/Get_Event_Result）或已写出的字节数，
+ *   写操作通过 Submit_Writev 提交，不需要重新注册事件
+ *
+ * 事件类型沿用 epoll 的标志：
+ *   EPOLLIN                 // 监听套接字有新连接 / 连接上有数据（完成式后端中数据已读入）
+ *   EPOLLOUT                // 连接可写 / writev 已完成（完成式后端中 Get_Event_Result 为写出的字节数）
+ *   EPOLLRDHUP|EPOLLHUP|EPOLLERR // 对端关闭或出错
+ *
+ * 接口：
+ *   bool AddFd(int fd, uint32_t events)        // 添加连接描述符
+ *   bool AddListenFd(int fd, uint32_t events)  // 添加监听描述符
+ *   bool ModFd(int fd, uint32_t events)        // 重新注册事件（完成式后端为空操作）
+ *   bool DelFd(int fd)                         // 移除描述符
+ *   int  Wait(int timeoutMs)                   // 等待事件，返回事件数
+ *   int  Get_Event_FileD(size_t idx) const     // 第 idx 个事件的描述符
+ *   uint32_t Get_Event_events(size_t idx) const // 第 idx 个事件的类型
+ *   bool Is_Completion_Based() const           // 是否为完成式后端
+ *   int  Get_Event_Result(size_t idx) const    // 完成式：新连接描述符/接收或写出的字节数
+ *   const char* Get_Event_Data(size_t idx) const // 完成式：接收到的数据，下一次 Wait 前有效
+ *   bool Submit_Writev(int fd, const iovec* iov, int count) // 完成式：提交 writev，iov 须在完成前保持有效
+ *   void Retire_Writev(int fd, std::shared_ptr<const void> owner) // 完成式：关闭连接时交出 writev 引用的内存，完成后释放
+ *
+ * 路径：webserve/include/event_backend.h
+ */
+#pragma once
+#include<sys/epoll.h> //EPOLLIN等事件标志
+#include<sys/uio.h> //iovec
+#include<stddef.h>
+#include<stdint.h>
+#include<memory>
+
+class EventBackend{
+    public:
+    virtual ~EventBackend()=default;
+    //将连接描述符FileD的Events动作加入监控
+    virtual bool AddFd(int FileD,uint32_t Events)=0;
+    //将监听描述符FileD加入监控
+    virtual bool AddListenFd(int FileD,uint32_t Events){
+        return AddFd(FileD,Events);
+    }
+    //修改描述符FileD对应的事件
+    virtual bool ModFd(int FileD,uint32_t Events)=0;
+    //移除对描述符FileD的监控
+    virtual bool DelFd(int FileD)=0;
+    //等待直到有事件发生或超时，返回事件数
+    virtual int Wait(int timeoutMs)=0;
+    //获得事件对应的描述符
+    virtual int Get_Event_FileD(size_t Index) const=0;
+    //获得事件对应的类型
+    virtual uint32_t Get_Event_events(size_t Index) const=0;
+
+    //是否为完成式后端（IO由后端完成）
+    virtual bool Is_Completion_Based() const{
+        return false;
+    }
+    //完成式后端：事件的结果(新连接描述符、接收或写出的字节数，出错时为-errno)
+    virtual int Get_Event_Result(size_t Index) const{
+        return 0;
+    }
+    //完成式后端：接收到的数据，下一次Wait前有效
+    virtual const char* Get_Event_Data(size_t Index) const{
+        return nullptr;
+    }
+    //完成式后端：提交一次writev，完成后以EPOLLOUT事件返回
+    virtual bool Submit_Writev(int FileD,const iovec* Iov,int Count){
+        return false;
+    }
+    //完成式后端：关闭连接前调用（须在DelFd之前），Owner保持到该描述符上已提交的writev完成或被取消；
+    //没有进行中的writev时立即释放。就绪式后端的写是同步的，直接释放
+    virtual void Retire_Writev(int FileD,std::shared_ptr<const void> Owner){}
+};
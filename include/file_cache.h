@@ -0,0 +1,233 @@
+/*
+ * @file_cache.cpp
+ * ---------------
+ * 这是静态资源的打开文件与元数据缓存的实现文件，所有 Reactor 与线程共享一个实例。
+ *
+ * 主要功能：
+ * - 以请求路径为键缓存文件的描述符、stat 信息与只读映射，热点静态文件的 GET 不再产生 stat/open/mmap/munmap
+ * - 缓存项以 std::shared_ptr 引用计数：失效时从表中移除，正在发送它的响应仍持有引用，最后一个引用释放时才 munmap/close
+ * - 读多写少：查找使用共享锁，加载文件在锁外进行
+ * - 通过 inotify 监视资源目录（递归），文件修改、删除、移动时使对应缓存项失效
+ * - 可选 TTL：缓存项超过 TTL 后重新加载；inotify 不可用时自动启用默认 TTL
+ * - 加载时生成验证器：强 ETag（inode、大小与纳秒级修改时间）与 Last-Modified（HTTP 日期）
+ * - 每个缓存项附带预先生成的响应头（按状态码与是否保持连接区分，第一次使用时生成），
+ *   与缓存项一同失效，响应按引用发送，不再逐个请求拼接
+ * - 小文件（不超过 small_file_max）读入内存，不占用描述符与映射（没有 mmap/munmap，也没有每个文件一个 VMA），
+ *   其预先生成的响应头之后直接拼接文件内容，整个响应是一段连续内存，一次 write 发出；
+ *   内存中的缓存项（含拼接的响应）总量受 small_file_cache_size 限制，超出时按 CLOCK 淘汰：
+ *   内存中的缓存项按放入的先后排队，放入后被使用过（粗粒度时钟变化）的给一次第二次机会，
+ *   总字节数由缓存项自己计入与退还，淘汰的代价与检查的项数成正比，不遍历、不排序整个表
+ * - 启动预热：遍历资源目录，在开始服务前加载全部文件；加载在锁外进行，已缓存的路径跳过，
+ *   之后在写锁内并入缓存（保留已有的项与已生成的响应头），总项数不超过缓存项数量上限；
+ *   预算内的映射用 MAP_POPULATE 预先建立页表，第一个请求不再承担 stat/open/mmap 与缺页
+ * - 预压缩：加载文件时一并加载同目录下的 .br/.gz 兄弟文件（不比原文件旧且更小时才使用），
+ *   兄弟文件变化时原文件的缓存项一同失效；没有兄弟文件的请求不再产生额外的 stat
+ *
+ * 类 FileCache 提供如下接口：
+ *   static FileCache& Instance()                        // 进程内唯一的缓存
+ *   void Init(const std::string& Root, int TtlMs, bool Precompressed, size_t Small_Max, size_t Small_Budget)
+ *                                                      // 设置资源目录并开始监视，TtlMs 为 0 表示只依赖 inotify，
+ *                                                      // Precompressed 为 true 时加载 .br/.gz 兄弟文件，
+ *                                                      // 不超过 Small_Max 字节的文件读入内存，总量不超过 Small_Budget
+ *   size_t Small_File_Max() const                       // 读入内存的文件的长度上限（0 表示不读入）
+ *   Warm_Up_Stats Warm_Up(size_t Populate_Budget)        // 预热：加载资源目录下的全部文件，预先建立不超过 Populate_Budget 字节的映射的页表
+ *   std::shared_ptr<const File> Get(const std::string& Dir, std::string_view Path)
+ *                                                      // 获取 Dir+Path 对应的文件，文件不存在或路径不规范时返回 nullptr
+ *   size_t Size() const                                 // 当前缓存项数量
+ *
+ * 使用说明：
+ * 1. 服务器启动时调用 Instance().Init(资源目录, TTL)。
+ * 2. 需要预热时在 Init 之后、开始服务之前调用 Warm_Up。
+ * 3. 每个请求调用 Get 获取文件，在响应发送完之前持有返回的 shared_ptr。
+ * 4. Path 不是规范路径（含 "//"、"." 或 ".." 段）时返回 nullptr，不访问文件系统；
+ *    Dir 不是 Init 设置的资源目录时不缓存，每次重新加载。
+ * 5. 兄弟文件由 bin/precompress 离线生成，响应按 Accept-Encoding 选用 File::Brotli 或 File::Gzip。
+ *
+ * 依赖：
+ * - Linux 系统调用（stat, open, mmap, inotify, eventfd, poll）
+ * - <shared_mutex>、<thread>、<filesystem> 等标准库
+ *
+ * 路径：webserve/src/file_cache.cpp
+ */
+#pragma once
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<memory>
+#include<shared_mutex>
+#include<mutex>
+#include<thread>
+#include<chrono>
+#include<atomic>
+#include<deque>
+#include<sys/stat.h> //stat
+#include<sys/mman.h> //mmap,munmap
+#include<fcntl.h> //open
+#include<unistd.h> //close
+#include<assert.h>
+
+class FileCache{
+    public:
+    //一个被缓存的文件
+    struct File{
+        //预先生成的响应头的槽位数（状态码与是否保持连接的组合）
+        static const size_t HEADER_SLOTS=10;
+        //打开的只读描述符，目录或不可读文件为-1
+        int Fd;
+        //文件状态信息
+        struct stat Stat;
+        //只读映射，空文件、目录或不可读文件为nullptr；内存中的文件指向Content
+        char* Data;
+        //内存中的文件（小文件或动态压缩的结果，见GzipCache）的内容，此时Fd为-1，没有映射
+        std::string Content;
+        //最近一次被查找的时间（粗粒度时钟，毫秒），用于淘汰内存中的缓存项
+        mutable std::atomic<uint64_t> Last_Used;
+        //已生成的响应头（小文件含拼接的内容）的总字节数
+        mutable std::atomic<size_t> Header_Bytes;
+        //计入内存预算的计数器（内存中的文件放入缓存时设置，之后才会被其它线程看到）与已计入的字节数，释放时退还
+        mutable std::atomic<int64_t>* Budget;
+        mutable std::atomic<size_t> Budget_Bytes;
+        //加载时间，用于TTL
+        std::chrono::steady_clock::time_point Loaded;
+        //强验证器（带引号）与HTTP日期格式的修改时间，目录与不可读文件为空
+        std::string ETag;
+        std::string Last_Modified;
+        //预先生成的响应头（状态行到空行，内存中的小文件之后紧接文件内容），未生成时为nullptr；多个线程可能同时生成，先安装的生效
+        mutable std::atomic<const std::string*> Headers[HEADER_SLOTS];
+        //作为预压缩版本加载时的内容编码（"br"或"gzip"），原文件为空
+        std::string Encoding;
+        //预压缩的兄弟文件（.br与.gz），没有或不可用时为nullptr
+        std::shared_ptr<const File> Brotli;
+        std::shared_ptr<const File> Gzip;
+        //GzipCache动态压缩的结果，命中时不加锁、不构造键；随缓存项一同失效，被GzipCache淘汰时清空
+        mutable std::atomic<std::shared_ptr<const File>> Dynamic_Gzip;
+        //Dynamic_Gzip最近被使用过（GzipCache淘汰时给它第二次机会），以及压缩后没有明显变小（不再尝试）
+        mutable std::atomic<bool> Dynamic_Gzip_Used;
+        mutable std::atomic<bool> Incompressible;
+        //内容是否可以发送（打开了描述符或在内存中）
+        bool Readable() const{
+            return Fd>=0||!Content.empty();
+        }
+        //在内存中占用的字节数（内容、已生成的响应头与内存中的预压缩版本）
+        size_t Memory_Bytes() const;
+        //是否有预压缩版本（响应需要Vary: Accept-Encoding）
+        bool Has_Encodings() const{
+            return Brotli||Gzip;
+        }
+        //第Slot个响应头，未生成时返回nullptr
+        const std::string* Header(size_t Slot) const{
+            return Headers[Slot].load(std::memory_order_acquire);
+        }
+        //安装第Slot个响应头，返回最终生效的那一个
+        const std::string* Store_Header(size_t Slot,std::string Header) const;
+        File();
+        ~File();
+        File(const File&)=delete;
+        File& operator=(const File&)=delete;
+    };
+
+    //预热的结果
+    struct Warm_Up_Stats{
+        //加载的文件数、读入内存的字节数与预先建立页表的映射字节数
+        size_t Files;
+        size_t Memory_Bytes;
+        size_t Populated_Bytes;
+        //耗时（毫秒）
+        double Milliseconds;
+        //加载期间文件发生变化，结果没有放入缓存
+        bool Discarded;
+        //达到缓存项数量上限，其余文件没有预热
+        bool Capped;
+    };
+
+    private:
+    //缓存项数量上限，超过后新文件不再缓存（每项占用一个描述符）
+    static const size_t MAX_ENTRIES_=4096;
+    //inotify不可用时使用的TTL
+    static const int DEFAULT_TTL_MS_=1000;
+
+    //支持以std::string_view查找，命中时不构造std::string
+    struct Path_Hash_{
+        using is_transparent=void;
+        size_t operator()(std::string_view Path) const{
+            return std::hash<std::string_view>()(Path);
+        }
+    };
+
+    //资源目录（不以'/'结尾）
+    std::string Root_;
+    //TTL，0表示不过期
+    std::chrono::milliseconds Ttl_;
+    //是否加载预压缩的兄弟文件
+    bool Precompressed_;
+    //读入内存的文件的长度上限与内存中缓存项的总字节数上限
+    size_t Small_Max_;
+    size_t Small_Budget_;
+    //内存中的缓存项（内容、已生成的响应头与内存中的预压缩版本）计入预算的总字节数，缓存项释放时退还
+    std::atomic<int64_t> Memory_Bytes_;
+    //内存中的缓存项的淘汰队列（CLOCK）：按放入的先后排列，Stamp为入队时的Last_Used；
+    //已失效或被替换的项在出队或压缩队列时丢弃
+    struct Memory_Entry_{
+        std::string Path;
+        std::weak_ptr<const File> Entry;
+        uint64_t Stamp;
+    };
+    std::deque<Memory_Entry_> Memory_Queue_;
+    //请求路径到缓存项
+    std::unordered_map<std::string,std::shared_ptr<const File>,Path_Hash_,std::equal_to<>>Files_;
+    mutable std::shared_mutex Mutex_;
+    //每次失效加一，加载期间发生过失效的结果不放入缓存
+    uint64_t Generation_;
+
+    //inotify描述符、通知监视线程退出的eventfd，以及监视描述符到相对目录的映射（只在监视线程中访问）
+    int InotifyFd_;
+    int StopFd_;
+    std::unordered_map<int,std::string>Watch_Dirs_;
+    std::thread Watcher_;
+
+    FileCache();
+    //打开并映射文件（不超过Small_Max字节时读入内存），文件不存在时返回nullptr；Siblings为true时一并加载.br/.gz兄弟文件
+    //Populate为true时用MAP_POPULATE预先建立页表
+    static std::shared_ptr<const File> load_(const std::string& FullPath,bool Siblings=false,size_t Small_Max=0,
+                                             bool Populate=false);
+    //加载FullPath的预压缩兄弟文件，不可用（不存在、不可读、比原文件旧或不比原文件小）时返回nullptr
+    static std::shared_ptr<const File> load_sibling_(const std::string& FullPath,const File& Original,const char* Encoding,
+                                                     size_t Small_Max);
+    //粗粒度单调时钟（毫秒），只用于比较最近使用的先后
+    static uint64_t now_coarse_();
+    //刚放入表中的内存文件计入预算并加入淘汰队列（持有写锁）
+    void charge_memory_(const std::string& Path,const std::shared_ptr<const File>& Entry);
+    //内存中的缓存项超出预算时按CLOCK淘汰（持有写锁）
+    void evict_memory_();
+    //Path是否为预压缩的兄弟文件（以.br或.gz结尾），是时Base为原文件的路径
+    static bool is_sibling_(std::string_view Path,std::string_view& Base);
+    //由状态信息生成ETag与Last-Modified
+    static void make_validators_(File& Loaded);
+    //Path是否为可以作为键的规范路径
+    static bool is_canonical_(std::string_view Path);
+    //监视相对目录Dir及其全部子目录
+    void watch_tree_(const std::string& Dir);
+    //使Path及（为目录时）其下的全部缓存项失效
+    void invalidate_(const std::string& Path,bool Tree);
+    //监视线程：读取inotify事件并使缓存项失效
+    void watch_loop_();
+
+    public:
+    ~FileCache();
+    FileCache(const FileCache&)=delete;
+    FileCache& operator=(const FileCache&)=delete;
+
+    static FileCache& Instance();
+    //设置资源目录并开始监视
+    void Init(const std::string& Root,int TtlMs=0,bool Precompressed=true,size_t Small_Max=0,size_t Small_Budget=0);
+    //读入内存的文件的长度上限，0表示不读入
+    size_t Small_File_Max() const{
+        return Small_Max_;
+    }
+    //预热：加载资源目录下的全部文件，预先建立不超过Populate_Budget字节的映射的页表
+    Warm_Up_Stats Warm_Up(size_t Populate_Budget);
+    //获取文件，不存在或路径不规范时返回nullptr
+    std::shared_ptr<const File> Get(const std::string& Dir,std::string_view Path);
+    //当前缓存项数量
+    size_t Size() const;
+};
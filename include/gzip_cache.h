@@ -0,0 +1,121 @@
+/*
+ * @gzip_cache.cpp
+ * ---------------
+ * 这是动态 gzip 压缩结果的缓存的实现文件，所有 Reactor 与线程共享一个实例。
+ *
+ * 主要功能：
+ * - 没有预压缩兄弟文件的可压缩资源，第一次被接受 gzip 的请求访问时在线程池中压缩，
+ *   结果以 (路径, 纳秒级修改时间, 编码) 为键放入按字节数限制容量的 LRU，同时放入原文件缓存项的
+ *   Dynamic_Gzip 槽（不可压缩时标记 Incompressible）；之后的请求直接从槽中取得，不构造键、不加锁
+ * - 命中槽时只设置原文件的 Dynamic_Gzip_Used 标记，不移动 LRU；淘汰时被标记过的项清除标记后移到最前（第二次机会），
+ *   被淘汰的项清空原文件的槽
+ * - 槽随 FileCache 的缓存项一同失效；缓存项按 TTL 重新加载后，第一次访问按键在 LRU 中找到结果并放入新缓存项的槽
+ * - 压缩在后台进行：未命中的请求照常发送原文件，不等待压缩完成；同一个键同时只有一个压缩任务
+ * - 压缩结果是一个内存中的 FileCache::File（Content 持有数据，Encoding 为 "gzip"，ETag 在原 ETag 后加 "-gz"），
+ *   与预压缩文件走同一条发送路径，并各自缓存预先生成的响应头
+ * - 压缩后没有明显变小的文件记为不可压缩，不再重复尝试
+ * - 文件修改后修改时间变化，旧的结果不再被命中，按 LRU 淘汰（原文件缓存项已释放的项直接淘汰）
+ *
+ * 类 GzipCache 提供如下接口：
+ *   static GzipCache& Instance()                     // 进程内唯一的缓存
+ *   void Init(size_t Capacity, size_t Min_Length, CoroutineThreadPool* Pool)
+ *                                                   // 设置容量（字节，0 表示不压缩）、最小压缩长度与执行压缩的线程池
+ *   bool Enabled(size_t Length) const                // 长度为 Length 的文件是否可能被压缩（决定响应是否带 Vary）
+ *   std::shared_ptr<const FileCache::File> Get(std::string_view Path, const std::shared_ptr<const FileCache::File>& Original)
+ *                                                   // 取得压缩结果，没有时安排压缩并返回 nullptr
+ *   Stats Get_Stats() const                          // 缓存项数、字节数与命中情况
+ *
+ * 使用说明：
+ * 1. 服务器启动时调用 Instance().Init(容量, 最小长度, 线程池)。
+ * 2. HttpResponse 在客户端接受 gzip、MIME 类型可压缩且没有预压缩文件时调用 Get，返回非空时发送它。
+ *
+ * 依赖：
+ * - zlib（-lz）
+ * - FileCache、CoroutineThreadPool
+ *
+ * 路径：webserve/src/gzip_cache.cpp
+ */
+#pragma once
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<unordered_set>
+#include<list>
+#include<memory>
+#include<mutex>
+#include<atomic>
+#include"file_cache.h"
+#include"ThreadPool.h"
+
+class GzipCache{
+    public:
+    //缓存的统计
+    struct Stats{
+        //缓存项数（含不可压缩的记录）与压缩结果的字节数
+        size_t Entries;
+        size_t Bytes;
+        //命中与未命中的次数、完成的压缩次数
+        size_t Hits;
+        size_t Misses;
+        size_t Compressions;
+    };
+
+    private:
+    //压缩后至少减少1/20才使用
+    static const size_t MIN_SAVING_DIVISOR_=20;
+    //缓存项数量上限（不可压缩的记录不占字节数，也需要限制）
+    static const size_t MAX_ENTRIES_=4096;
+
+    //一个缓存项：压缩结果（不可压缩时为nullptr），以及最近一次放入其槽中的原文件缓存项
+    struct Entry_{
+        std::string Key;
+        std::shared_ptr<const FileCache::File> File;
+        std::weak_ptr<const FileCache::File> Original;
+    };
+
+    //容量（字节），0表示不压缩
+    size_t Capacity_;
+    //小于该长度的文件不压缩
+    size_t Min_Length_;
+    //执行压缩的线程池，为nullptr时在调用线程中压缩
+    CoroutineThreadPool* Pool_;
+
+    //最近使用的在前
+    std::list<Entry_> Lru_;
+    std::unordered_map<std::string,std::list<Entry_>::iterator> Index_;
+    //正在压缩的键
+    std::unordered_set<std::string> Pending_;
+    size_t Bytes_;
+    //命中槽时不加锁，计数为原子变量
+    std::atomic<size_t> Hits_;
+    std::atomic<size_t> Misses_;
+    std::atomic<size_t> Compressions_;
+    mutable std::mutex Mutex_;
+
+    GzipCache();
+    //缓存的键：路径、纳秒级修改时间与编码
+    static std::string make_key_(std::string_view Path,const FileCache::File& Original);
+    //压缩Original并放入缓存
+    void compress_(const std::string& Key,const std::shared_ptr<const FileCache::File>& Original);
+    //放入缓存与Original的槽（持有锁），超出容量时淘汰最久未使用的项
+    void insert_(const std::string& Key,std::shared_ptr<const FileCache::File> File,
+                 const std::shared_ptr<const FileCache::File>& Original);
+    //把缓存项的结果放入Original的槽（持有锁）
+    static void install_(Entry_& Item,const std::shared_ptr<const FileCache::File>& Original);
+
+    public:
+    GzipCache(const GzipCache&)=delete;
+    GzipCache& operator=(const GzipCache&)=delete;
+
+    static GzipCache& Instance();
+    //设置容量、最小压缩长度与线程池
+    void Init(size_t Capacity,size_t Min_Length,CoroutineThreadPool* Pool);
+    //长度为Length的文件是否可能被压缩
+    bool Enabled(size_t Length) const{
+        return Capacity_>0&&Length>=Min_Length_;
+    }
+    //取得压缩结果，没有时安排压缩并返回nullptr
+    std::shared_ptr<const FileCache::File> Get(std::string_view Path,const std::shared_ptr<const FileCache::File>& Original);
+    //缓存的统计
+    Stats Get_Stats() const;
+};
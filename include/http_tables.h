@@ -0,0 +1,217 @@
+/*
+ * @http_tables.h
+ * --------------
+ * 这是响应用到的静态查找表：文件后缀到 MIME 类型、状态码到状态行与错误页面。
+ *
+ * 主要功能：
+ * - MimeTable：编译期（constexpr）生成的完美哈希表（hash-and-displace：先按一次哈希分桶，
+ *   再为每个桶找一个位移使桶内的键落到互不冲突的槽），查找只计算两次短哈希、比较一次字符串，
+ *   不分配内存，也不探测；每项保存预先生成的 "Content-Type: ...\r\n" 响应头行，Type() 为其中的 MIME 类型
+ * - 后缀不区分大小写
+ * - 同一个构造函数也可以在运行时使用：启动时用内置表加上 config.json 中的 mime_types 重新生成
+ * - StatusTable：编译期生成的按状态码直接下标的表，每项保存原因短语、预先生成的状态行与错误页面路径
+ *
+ * 类 MimeTable 提供如下接口：
+ *   constexpr MimeTable(const Entry* Entries, size_t Count)   // 生成表，后缀不能重复
+ *   constexpr bool Valid() const                              // 是否生成成功（项数超出容量或后缀重复时失败）
+ *   constexpr const Entry* Find(std::string_view Suffix) const // 查找后缀（含 '.'），没有时返回 nullptr
+ *   constexpr size_t Size() const                             // 项数
+ *
+ * 类 StatusTable 提供如下接口：
+ *   constexpr StatusTable(const Entry* Entries, size_t Count)  // 生成表
+ *   constexpr const Entry* Find(int Code) const               // 查找状态码，没有时返回 nullptr
+ *
+ * 依赖：
+ * - C++20（constexpr 函数中的循环与局部数组）
+ *
+ * 路径：webserve/include/http_tables.h
+ */
+#pragma once
+#include<string_view>
+#include<cstdint>
+#include<cstddef>
+
+class MimeTable{
+    public:
+    //一项：后缀（含'.'）与预先生成的Content-Type响应头行
+    struct Entry{
+        std::string_view Suffix;
+        std::string_view Header;
+        //响应头行中的MIME类型
+        constexpr std::string_view Type() const{
+            return Header.substr(HEADER_PREFIX.size(),Header.size()-HEADER_PREFIX.size()-2);
+        }
+    };
+    //响应头行的前缀，Header为HEADER_PREFIX+类型+"\r\n"
+    static constexpr std::string_view HEADER_PREFIX="Content-Type: ";
+    //最多的项数
+    static constexpr size_t MAX_ENTRIES=192;
+
+    private:
+    //槽数与桶数（2的幂）
+    static constexpr size_t SLOTS_=256;
+    static constexpr size_t BUCKETS_=64;
+    //为一个桶寻找位移的最大尝试次数
+    static constexpr uint32_t MAX_DISPLACEMENT_=1u<<16;
+
+    //槽，空槽的Suffix为空
+    Entry Slots_[SLOTS_];
+    //每个桶的位移，0表示空桶
+    uint32_t Displacement_[BUCKETS_];
+    size_t Count_;
+    bool Valid_;
+
+    static constexpr unsigned char lower_(char C){
+        unsigned char u=static_cast<unsigned char>(C);
+        return (u>='A'&&u<='Z')?u+('a'-'A'):u;
+    }
+    static constexpr bool equal_(std::string_view A,std::string_view B){
+        if(A.size()!=B.size()){
+            return false;
+        }
+        for(size_t i=0;i<A.size();++i){
+            if(lower_(A[i])!=lower_(B[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+    //FNV-1a加上末尾混合，Seed不同得到不同的哈希函数
+    static constexpr uint32_t hash_(std::string_view Key,uint32_t Seed){
+        uint32_t h=2166136261u^(Seed*0x9e3779b9u);
+        for(char c:Key){
+            h^=lower_(c);
+            h*=16777619u;
+        }
+        h^=h>>15;
+        h*=0x2c1b3c6du;
+        h^=h>>12;
+        return h;
+    }
+    //hash-and-displace：项多的桶先放，每个桶找一个使其全部项落到空槽的位移
+    constexpr bool build_(const Entry* Entries,size_t Count){
+        if(Count>MAX_ENTRIES){
+            return false;
+        }
+        size_t bucket_of[MAX_ENTRIES]={};
+        size_t sizes[BUCKETS_]={};
+        for(size_t i=0;i<Count;++i){
+            bucket_of[i]=hash_(Entries[i].Suffix,0)%BUCKETS_;
+            ++sizes[bucket_of[i]];
+        }
+        size_t order[BUCKETS_]={};
+        for(size_t b=0;b<BUCKETS_;++b){
+            //按项数从多到少插入排序
+            size_t j=b;
+            while(j>0&&sizes[order[j-1]]<sizes[b]){
+                order[j]=order[j-1];
+                --j;
+            }
+            order[j]=b;
+        }
+        bool used[SLOTS_]={};
+        for(size_t b:order){
+            if(sizes[b]==0){
+                break;
+            }
+            bool placed=false;
+            for(uint32_t d=1;d<MAX_DISPLACEMENT_&&!placed;++d){
+                size_t slots[MAX_ENTRIES]={};
+                size_t n=0;
+                bool ok=true;
+                for(size_t i=0;i<Count&&ok;++i){
+                    if(bucket_of[i]!=b){
+                        continue;
+                    }
+                    size_t s=hash_(Entries[i].Suffix,d)%SLOTS_;
+                    if(used[s]){
+                        ok=false;
+                    }
+                    for(size_t k=0;k<n&&ok;++k){
+                        if(slots[k]==s){
+                            //同一个桶内冲突（后缀重复时总是冲突）
+                            ok=false;
+                        }
+                    }
+                    slots[n++]=s;
+                }
+                if(!ok){
+                    continue;
+                }
+                n=0;
+                for(size_t i=0;i<Count;++i){
+                    if(bucket_of[i]==b){
+                        used[slots[n]]=true;
+                        Slots_[slots[n++]]=Entries[i];
+                    }
+                }
+                Displacement_[b]=d;
+                placed=true;
+            }
+            if(!placed){
+                return false;
+            }
+        }
+        Count_=Count;
+        return true;
+    }
+
+    public:
+    constexpr MimeTable(const Entry* Entries,size_t Count):Slots_{},Displacement_{},Count_(0),Valid_(false){
+        Valid_=build_(Entries,Count);
+    }
+    //是否生成成功
+    constexpr bool Valid() const{
+        return Valid_;
+    }
+    //查找后缀（含'.'），没有时返回nullptr
+    constexpr const Entry* Find(std::string_view Suffix) const{
+        uint32_t d=Displacement_[hash_(Suffix,0)%BUCKETS_];
+        if(d==0){
+            return nullptr;
+        }
+        const Entry& entry=Slots_[hash_(Suffix,d)%SLOTS_];
+        return (!entry.Suffix.empty()&&equal_(entry.Suffix,Suffix))?&entry:nullptr;
+    }
+    //项数
+    constexpr size_t Size() const{
+        return Count_;
+    }
+};
+
+class StatusTable{
+    public:
+    //一项：状态码、原因短语、预先生成的状态行与错误页面路径（没有时为空）
+    struct Entry{
+        int Code;
+        std::string_view Reason;
+        std::string_view Line;
+        std::string_view Error_Page;
+    };
+
+    private:
+    static constexpr int MIN_CODE_=100;
+    static constexpr int MAX_CODE_=599;
+    static constexpr size_t MAX_ENTRIES_=32;
+
+    Entry Entries_[MAX_ENTRIES_];
+    //状态码减MIN_CODE_到项的下标加一，0表示没有
+    uint8_t Index_[MAX_CODE_-MIN_CODE_+1];
+
+    public:
+    constexpr StatusTable(const Entry* Entries,size_t Count):Entries_{},Index_{}{
+        for(size_t i=0;i<Count&&i<MAX_ENTRIES_;++i){
+            Entries_[i]=Entries[i];
+            if(Entries[i].Code>=MIN_CODE_&&Entries[i].Code<=MAX_CODE_){
+                Index_[Entries[i].Code-MIN_CODE_]=static_cast<uint8_t>(i+1);
+            }
+        }
+    }
+    //查找状态码，没有时返回nullptr
+    constexpr const Entry* Find(int Code) const{
+        if(Code<MIN_CODE_||Code>MAX_CODE_||Index_[Code-MIN_CODE_]==0){
+            return nullptr;
+        }
+        return &Entries_[Index_[Code-MIN_CODE_]-1];
+    }
+};
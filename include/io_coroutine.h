@@ -0,0 +1,59 @@
+/*
+ * @io_coroutine.h
+ * ---------------
+ * 这是连接协程的返回类型，每个连接一个协程帧，在连接建立时创建、连接关闭时销毁。
+ *
+ * 主要功能：
+ * - 协程创建后先挂起（initial_suspend），由 Reactor 在第一次可读事件时恢复
+ * - 协程结束后也挂起（final_suspend），由持有者通过 Done 判断连接是否应关闭，再销毁协程帧
+ * - 协程内部通过 HttpConnection::async_read/async_write 在 EAGAIN 时挂起，
+ *   Reactor 在描述符就绪时恢复，每个事件只是一次 resume，没有任务分配
+ *
+ * 类 IoCoroutine 提供如下接口：
+ *   std::coroutine_handle<> Release()   // 交出协程帧的所有权
+ *
+ * 依赖：
+ * - C++20 coroutine
+ *
+ * 路径：webserve/include/io_coroutine.h
+ */
+#pragma once
+#include<coroutine>
+#include<exception>
+#include<utility>
+
+class IoCoroutine{
+    public:
+    struct promise_type{
+        IoCoroutine get_return_object(){
+            return IoCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept{
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept{
+            return {};
+        }
+        void return_void(){}
+        void unhandled_exception(){
+            std::terminate();
+        }
+    };
+
+    IoCoroutine(IoCoroutine&& Other) noexcept:Handle_(std::exchange(Other.Handle_,nullptr)){}
+    IoCoroutine(const IoCoroutine&)=delete;
+    IoCoroutine& operator=(const IoCoroutine&)=delete;
+    ~IoCoroutine(){
+        if(Handle_){
+            Handle_.destroy();
+        }
+    }
+    //交出协程帧的所有权
+    std::coroutine_handle<> Release(){
+        return std::exchange(Handle_,nullptr);
+    }
+
+    private:
+    explicit IoCoroutine(std::coroutine_handle<promise_type> Handle):Handle_(Handle){}
+    std::coroutine_handle<promise_type> Handle_;
+};
@@ -0,0 +1,98 @@
+/*
+ * @output_queue.cpp
+ * -----------------
+ * 这是连接输出队列（分段链）的实现文件，响应由若干段组成，各段引用其它地方持有的内存，发送时不拷贝。
+ *
+ * 主要功能：
+ * - 三种段：外部内存（缓存的响应头、内存映射的文件等，可附带持有者引用，段发送完时释放）、
+ *   Buffer 段（Buffer 中按顺序写入的一段数据，发送时从它的读位置取得，Buffer 扩容移动也不影响）、
+ *   文件段（用 sendfile 从页缓存发送）
+ * - 连续的内存段合并为一次 writev，最多 IOV_MAX 个 iovec；后面还有文件段时改用 sendmsg(MSG_MORE)，
+ *   让内核把它们与文件首段合并发送
+ * - 每段记录自己的发送进度，部分写出后从中断处继续；Buffer 段写出后推进 Buffer 的读位置
+ *
+ * 类 OutputQueue 提供如下接口：
+ *   void Append(const char* Data, size_t Length, Owner)    // 追加外部内存段，Owner 保证发送完之前内存有效
+ *   void Append_Buffer(Buffer& Buff, size_t Length)        // 追加 Buff 中最后写入的 Length 字节
+ *   void Append_File(int FileD, off_t Offset, size_t Length, Owner) // 追加文件段
+ *   ssize_t Send(int FileD, int* Errno)                    // 发送队首的一批段，不推进进度（文件被截断时 EIO）
+ *   void Consume(size_t Length)                            // 已发送 Length 字节后推进各段
+ *   const iovec* Build_Iov(int* Count)                     // 队首连续内存段的 iovec（完成式后端提交 writev 用）
+ *   size_t Size() const                                    // 待发送的总字节数
+ *   void Clear()                                           // 丢弃所有段
+ *
+ * 使用说明：
+ * 1. HttpConnection 生成响应后按顺序追加响应头（Buffer 段）与文件内容（内存段或文件段）；
+ *    流水线请求的多个响应依次追加，由一次 writev 写出。
+ * 2. 就绪式后端循环 Send/Consume 直到 Size 为 0；完成式后端提交 Build_Iov 得到的 iovec，完成后 Consume。
+ *
+ * 依赖：
+ * - Buffer 类
+ * - sys/uio.h (writev), sys/socket.h (sendmsg), sys/sendfile.h (sendfile), limits.h (IOV_MAX)
+ *
+ * 路径：webserve/src/output_queue.cpp
+ */
+#pragma once
+#include"buffer.h"
+#include<vector>
+#include<memory>
+#include<limits.h> //IOV_MAX
+#include<sys/uio.h> //writev
+#include<sys/socket.h> //sendmsg
+#include<sys/sendfile.h> //sendfile
+#include<sys/types.h>
+#include<errno.h> //EIO
+
+class OutputQueue{
+    private:
+    //一段待发送的数据
+    struct Segment_{
+        //外部内存段的起始位置(已发送的部分之后)
+        const char* Data;
+        //Buffer段：数据在Buff的读位置之后，按追加顺序排列
+        Buffer* Buff;
+        //文件段：描述符与下一次发送的偏移，其余段为-1
+        int File_Fd;
+        off_t File_Offset;
+        //剩余长度
+        size_t Length;
+        //段引用的内存或文件的持有者，段发送完时释放
+        std::shared_ptr<const void> Owner;
+    };
+    //一次writev最多的iovec数
+    static const int MAX_IOV_=IOV_MAX;
+    //一次Build_Iov最多涉及的不同Buffer数
+    static const int MAX_BUFFERS_=4;
+
+    //段链，Head_之前的段已发送完
+    std::vector<Segment_> Segments_;
+    size_t Head_;
+    //待发送的总字节数
+    size_t Size_;
+    //Build_Iov的结果，完成式后端提交后须保持到完成
+    std::vector<iovec> Iov_;
+
+    //从队首开始把连续的内存段（外部内存与Buffer段）填入Iov_，返回个数
+    int Fill_Iov_();
+
+    public:
+    OutputQueue();
+    //追加外部内存段，Owner为空时Data须在发送完之前保持有效
+    void Append(const char* Data,size_t Length,std::shared_ptr<const void> Owner=nullptr);
+    //追加Buff中最后写入的Length字节，发送后推进Buff的读位置
+    void Append_Buffer(Buffer& Buff,size_t Length);
+    //追加文件段，用sendfile发送
+    void Append_File(int FileD,off_t Offset,size_t Length,std::shared_ptr<const void> Owner=nullptr);
+    //发送队首的一批段（连续的内存段一次writev/sendmsg，或一个文件段），不推进进度
+    ssize_t Send(int FileD,int* Errno);
+    //已发送Length字节后推进各段，发送完的段出队
+    void Consume(size_t Length);
+    //队首连续内存段的iovec与个数，下一次Consume之前保持有效
+    const iovec* Build_Iov(int* Count);
+    //待发送的总字节数
+    size_t Size() const{
+        return Size_;
+    }
+    //丢弃所有段
+    void Clear();
+};
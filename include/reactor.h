@@ -0,0 +1,139 @@
+/**
+ * @file reactor.h
+ * @brief Reactor - 单个 epoll 事件循环
+ *
+ * 每个 Reactor 拥有独立的事件后端（Epoller 或 UringPoller）、TimerManager、连接表（按描述符索引的 ConnectionSlab）和监听套接字，
+ * 负责一个事件循环内的连接接入、读写事件分发与超时关闭。
+ *
+ * ## 两种运行方式
+ * - 单 Reactor：运行在主线程，读写事件提交给 CoroutineThreadPool 处理（原有模式，便于对比）；
+ *   连接只在 Reactor 线程上关闭：超时或对端挂断时协程正在工作线程上运行的，只标记关闭请求，
+ *   由工作线程在协程挂起后把连接交还（eventfd 唤醒 Reactor）
+ * - 多 Reactor：每个 Reactor 运行在独立线程并绑定到一个核心，监听套接字开启 SO_REUSEPORT，
+ *   由内核在多个监听套接字之间分发新连接，读写事件在本线程内直接处理，连接永不跨线程
+ *
+ * ## 事件后端
+ * - epoll：就绪式，每个连接一个协程（serve_）按顺序读请求、写响应，读写遇到 EAGAIN 时挂起；
+ *   描述符就绪时 Reactor 恢复协程，协程挂起后按它等待的事件 ModFd 重新注册（EPOLLONESHOT）
+ * - io_uring：完成式，数据已由内核接收，写操作批量提交；完成事件总是在本线程内直接处理，
+ *   初始化失败时回退到 epoll
+ *
+ * ## 主要成员
+ * - `init_socket_()`：初始化本 Reactor 的监听套接字
+ * - `add_client_connection_()`、`close_connection_()`：连接的加入与关闭
+ * - `request_close_()`、`hand_back_()`、`handle_wakeup_()`：超时/挂断时请求关闭，工作线程交还待关闭的连接
+ * - `handle_listen_()`、`handle_ready_()`：处理监听事件与连接的可读/可写事件
+ * - `serve_()`、`resume_()`：连接协程与它的恢复
+ * - `handle_completion_()`、`on_process_()`：处理完成式后端的一个事件与请求处理
+ * - `loop()`：事件循环主体
+ *
+ * ## 依赖
+ * - epoll.h
+ * - uring.h
+ * - timer.h
+ * - ThreadPool.h
+ * - HttpConnection.h
+ * - connection_slab.h
+ * @date 2025
+ */
+#pragma once
+#include"epoll.h"
+#include"uring.h"
+#include"timer.h"
+#include"ThreadPool.h"
+#include"HttpConnection.h"
+#include"connection_slab.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <sys/eventfd.h> // eventfd()
+#include <fcntl.h>       // fcntl()
+#include <unistd.h>      // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+class Reactor{
+    private:
+    //初始化套接字
+    bool init_socket_();
+
+    //添加客户端连接
+    void add_client_connection_(int fd,sockaddr_in addr);
+    //关闭客户端连接，只在Reactor线程上调用，协程须空闲或已由恢复它的线程交还
+    void close_connection_(HttpConnection* client);
+    //Reactor线程请求关闭连接（超时、对端挂断）：协程空闲时立即关闭，否则由恢复它的线程交还后关闭
+    void request_close_(HttpConnection* client);
+    //恢复协程的线程交还需要关闭的连接（单Reactor模式下经eventfd唤醒Reactor线程）
+    void hand_back_(HttpConnection* client);
+    //Reactor线程：关闭工作线程交还的连接
+    void handle_wakeup_();
+
+    //处理监听事件
+    void handle_listen_();
+    //处理连接的可读/可写事件：恢复连接的协程（单Reactor模式下投递到线程池）
+    void handle_ready_(HttpConnection* client);
+
+    //连接协程：读请求、生成响应、写响应，循环直到连接关闭
+    static IoCoroutine serve_(HttpConnection* client);
+    //恢复连接协程，协程结束时关闭连接，否则按它等待的事件重新注册
+    void resume_(HttpConnection* client);
+    //完成式后端：处理客户端请求并提交writev
+    void on_process_(HttpConnection* client);
+    //处理完成式后端的第index个事件
+    void handle_completion_(int index);
+    //创建事件后端，io_uring不可用时回退到epoll
+    static std::unique_ptr<EventBackend> create_backend_(const std::string& backend);
+
+    //发送错误信息
+    void send_error_(int fd,const char* information);
+    //延长客户端连接的定时器
+    void extent_time_(HttpConnection* client);
+
+    static const int max_fd_=65536;
+    //设置文件描述符为非阻塞模式
+    static int set_fd_nonblock_(int fd);
+
+    //服务器监听的端口号
+    int port_;
+    //是否开启套接字延迟关闭功能
+    bool open_linger_;
+    //是否开启SO_REUSEPORT，多Reactor模式下每个Reactor各自监听同一端口
+    bool reuse_port_;
+    //超时时间，单位为毫秒
+    int time_out_ms_;
+    //标记事件循环是否结束
+    bool close_or_not_;
+    //监听套接字的文件描述符
+    int listen_fd_;
+
+    //监听套接字的事件类型
+    uint32_t listen_event_;
+    //连接套接字的事件类型
+    uint32_t connection_event_;
+
+    //定时器管理器，用于处理超时事件
+    std::unique_ptr<TimerManager>timer_;
+    //事件后端，用于IO多路复用
+    std::unique_ptr<EventBackend>poller_;
+    //线程池，为nullptr时读写事件在本线程内直接处理
+    CoroutineThreadPool* threadpool_;
+    //本Reactor的客户端连接，按描述符索引，地址稳定
+    ConnectionSlab users_;
+    //单Reactor模式：工作线程交还的待关闭连接，以及唤醒Reactor线程的eventfd（其它模式为-1）
+    std::mutex closing_mutex_;
+    std::vector<HttpConnection*> closing_;
+    int wakeup_fd_;
+
+    public:
+    Reactor(int port,uint32_t listen_event,uint32_t connection_event,int timeout_ms,
+            bool opt_linger,bool reuse_port,CoroutineThreadPool* threadpool,const std::string& backend="epoll");
+    ~Reactor();
+    //监听套接字是否初始化成功
+    bool is_ready() const;
+    //运行事件循环
+    void loop();
+};
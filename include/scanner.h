@@ -0,0 +1,57 @@
+/*
+ * @scanner.cpp
+ * ------------
+ * 这是 HTTP 请求分隔符扫描器的实现文件，为 HttpRequest 一次性找出读缓冲区中所有的 CR、LF 与 ':' 位置。
+ *
+ * 主要功能：
+ * - AVX2 实现：每次比较 32 字节，三次 cmpeq 合并后用 movemask 得到位掩码
+ * - SSE4.2 实现：每次比较 16 字节，pcmpestrm 一条指令匹配 "\r\n:" 字符集
+ * - 标量实现：逐字节比较，作为回退并处理块尾不足一个向量的部分
+ * - 运行时根据 CPU 支持的指令集选择实现，无需额外的编译选项
+ *
+ * 类 DelimiterScanner 提供如下接口：
+ *   static size_t Scan(const char* Data, size_t& Pos, size_t End, uint32_t* Out, size_t Capacity)
+ *                                        // 从 Data+Pos 扫描到 Data+End，把分隔符相对于 Data 的偏移依次写入 Out，
+ *                                        // 返回写入的个数；Out 写满时提前返回，Pos 更新为下一次扫描的起点
+ *   static const char* Name()            // 当前使用的实现名称："avx2" / "sse4.2" / "scalar"
+ *   static size_t Scan_Scalar/Scan_Sse42/Scan_Avx2(...) // 各个实现，供基准测试直接调用
+ *
+ * 使用说明：
+ * 1. 调用 Scan 得到一批分隔符偏移，按顺序处理，处理完后以更新过的 Pos 再次调用。
+ * 2. 每个字节只被扫描一次；直接调用 Scan_Sse42/Scan_Avx2 前需确认 CPU 支持对应指令集。
+ *
+ * 依赖：
+ * - <immintrin.h>（x86 内建函数），非 x86 平台只使用标量实现
+ *
+ * 路径：webserve/src/scanner.cpp
+ */
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+
+class DelimiterScanner{
+    public:
+    //一种扫描实现
+    typedef size_t (*Scan_Func)(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity);
+    //使用运行时选出的实现扫描
+    static size_t Scan(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+        return Impl_(Data,Pos,End,Out,Capacity);
+    }
+    //当前使用的实现名称
+    static const char* Name();
+
+    //逐字节扫描
+    static size_t Scan_Scalar(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity);
+    //每次16字节，需要SSE4.2
+    static size_t Scan_Sse42(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity);
+    //每次32字节，需要AVX2
+    static size_t Scan_Avx2(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity);
+    //CPU是否支持SSE4.2/AVX2
+    static bool Has_Sse42();
+    static bool Has_Avx2();
+
+    private:
+    //运行时选出的实现，程序加载时确定
+    static const Scan_Func Impl_;
+    static Scan_Func Select_();
+};
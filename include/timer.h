@@ -6,21 +6,26 @@
  * 主要功能：
  * - 管理定时器的添加、删除、更新和触发
  * - 支持定时任务的回调处理
- * - 使用小根堆实现定时器优先级队列，保证高效的超时检测
+ * - 使用分层时间轮（毫秒粒度，4 层：256 x 1ms、64 x 256ms、64 x 16.4s、64 x 17.5min，最长约 18.6 小时），
+ *   添加、刷新、取消均为 O(1)；定时器按 id（连接的描述符）直接下标存放，没有哈希查找
+ * - 刷新只把过期时间推后时不移动结点，结点所在的槽到期时再按新的过期时间重新放入，
+ *   每次读写事件的 update 只是一次赋值
  *
  * 类 TimerManager 提供如下接口：
  *   void add_timer(int id, int timeout, const timeout_callback& cb) // 添加或更新定时器
  *   void work(int id)                                               // 触发指定定时器回调并删除
  *   void update(int id, int timeout)                                // 更新定时器超时时间
+ *   void cancel(int id)                                             // 删除定时器，不触发回调
  *   void handle_expired_event()                                     // 处理所有已到期定时器
  *   void clear()                                                    // 清空所有定时器
- *   int  get_next_timer_handle()                                    // 获取下一个定时器剩余时间
+ *   int  get_next_timer_handle()                                    // 处理到期定时器，返回下一次需要醒来的剩余毫秒数，没有定时器时为 -1
  *
  * 使用说明：
  * 1. 调用 add_timer 添加定时任务，指定唯一 id、超时时间和回调函数。
  * 2. 定期调用 handle_expired_event 检查并处理到期定时器。
  * 3. 可通过 update 更新定时器，或 work 立即触发并删除定时器。
- * 4. get_next_timer_handle 可用于 epoll 等待超时时间的动态调整。
+ * 4. get_next_timer_handle 可用于 epoll 等待超时时间的动态调整；时间轮只保证不晚于最早的定时器醒来，
+ *    定时器位于高层时可能提前醒来做一次下移。
  *
  * 依赖：
  * - timer.h 头文件
@@ -30,9 +35,7 @@
  */
 #pragma once
 #include"HttpConnection.h"
-#include<queue>
-#include<deque>
-#include<unordered_map>
+#include<vector>
 #include<ctime>
 #include<chrono>
 #include<functional>
@@ -52,40 +55,60 @@ typedef std::chrono::milliseconds ms;
 typedef hr_clock::time_point time_stamp;
 
 struct timer_node{
-    //标记
-    int id;
-    //过期时间
-    time_stamp expire;
+    //过期时间（时间轮的毫秒刻度）
+    int64_t expire;
+    //所在槽的链表中的前后结点（id），-1表示没有
+    int prev;
+    int next;
+    //所在的槽（各层连续编号），-1表示定时器未启用
+    int slot;
     //回调函数,方便删除定时器时将对应的HTTP连接关闭
-    timeout_callback call_back; 
-    //<重载
-    bool operator<(const timer_node& t)
-    {
-        return expire<t.expire;
-    }
+    timeout_callback call_back;
 };
 class TimerManager{
-    //std::shared_ptr：这是一个智能指针，用于管理共享所有权资源的内存。当没有更多的shared_ptr指向某个对象时，该对象会被自动删除。
-    typedef std::shared_ptr<timer_node> shared_timer_node;
     private:
-    //删除指定定时器
-    void del_(size_t index);
-    //向上调整
-    void siftup_(size_t index);
-    //向下调整
-    bool siftdown_(size_t index,size_t n);
-    //交换两个结点位置
-    void swap_node_(size_t index1,size_t index2);
+    //第0层256个槽，其余每层64个槽
+    static const int LEVELS_=4;
+    static const int ROOT_BITS_=8;
+    static const int LEVEL_BITS_=6;
+    static const int ROOT_SIZE_=1<<ROOT_BITS_;
+    static const int LEVEL_SIZE_=1<<LEVEL_BITS_;
+    static const int SLOT_COUNT_=ROOT_SIZE_+(LEVELS_-1)*LEVEL_SIZE_;
+    //时间轮能表示的最长时间（毫秒），更长的定时器按此截断
+    static const int64_t MAX_SPAN_=(int64_t(1)<<(ROOT_BITS_+(LEVELS_-1)*LEVEL_BITS_))-1;
+
+    //按id下标存放的定时器结点
+    std::vector<timer_node>nodes_;
+    //每个槽链表的头结点（id），-1表示空
+    int head_[SLOT_COUNT_];
+    //每层非空槽的位图
+    uint64_t bitmap_[LEVELS_][ROOT_SIZE_/64];
+    //时间轮已推进到的刻度
+    int64_t current_;
+    //启用中的定时器数量
+    size_t count_;
+    //刻度的起点
+    std::chrono::steady_clock::time_point start_;
+
+    //当前时间对应的刻度
+    int64_t now_() const;
+    //第level层第index个槽的编号
+    static int slot_of_(int level,int index);
+    //按过期时间把结点放入对应的槽
+    void link_(int id);
+    //把结点从所在的槽中取出
+    void unlink_(int id);
+    //推进一个刻度：必要时把上层的槽下移，然后处理第0层的槽
+    void tick_();
+    //把第level层第index个槽中的结点按过期时间重新放入
+    void cascade_(int level,int index);
+    //推进到当前时间
+    void advance_();
+    //从刻度current_起，第一个非空槽最早被处理的刻度，没有定时器时为-1
+    int64_t next_tick_() const;
 
-    //存储定时器的存储实体
-    std::vector<timer_node>heap_;
-    //映射一个fd对应的定时器在heap_中的位置
-    std::unordered_map<int,size_t>ref_;
     public:
-    TimerManager(){
-        //预分配容量
-        heap_.reserve(64);
-    };
+    TimerManager();
     ~TimerManager(){
         clear();
     }
@@ -101,6 +124,10 @@ class TimerManager{
     void update(int id,int timeout);
     //删除制定id节点，并且用指针触发处理函数
     void work(int id);
-    //从管理器中移除一个定时器
-    void pop();
-};
\ No newline at end of file
+    //删除指定id的定时器，不触发回调
+    void cancel(int id);
+    //启用中的定时器数量
+    size_t size() const{
+        return count_;
+    }
+};
@@ -0,0 +1,152 @@
+/*
+ * @uring.cpp
+ * -----------
+ * 这是一个基于 io_uring 的事件后端实现文件，是 EventBackend 的完成式实现，直接使用 io_uring 系统调用，不依赖 liburing。
+ *
+ * 主要功能：
+ * - 监听套接字使用 multishot accept，一次提交持续接受新连接
+ * - 连接套接字使用 multishot recv + 提供缓冲区环（provided buffer ring），一次提交持续接收数据，
+ *   数据由内核直接写入缓冲区环中的缓冲区，无需每次 readv
+ * - writev 只写入提交队列，在下一次 Wait 时与其它请求一起批量提交
+ * - 一次 io_uring_enter 同时完成提交与等待，没有 EPOLLONESHOT 的 epoll_ctl 重新注册
+ *
+ * 类 UringPoller 提供如下接口（见 event_backend.h）：
+ *   UringPoller(int MaxEvents)                 // 构造函数，指定每次 Wait 返回的最大事件数
+ *   bool Is_Ready() const                      // 内核是否支持所需特性，初始化是否成功
+ *   bool AddFd / AddListenFd / ModFd / DelFd   // 注册 multishot recv / multishot accept / 空操作 / 取消
+ *   int  Wait(int timeoutMs)                   // 批量提交并等待完成事件
+ *   bool Submit_Writev(int fd, const iovec* iov, int count) // 加入一次 writev 到提交队列
+ *   void Retire_Writev(int fd, std::shared_ptr<const void> owner) // 连接关闭时仍在进行的 writev 引用的内存，
+ *                                              // 保持到该 writev（按旧代数识别）的完成事件到达
+ *
+ * 使用说明：
+ * 1. 创建 UringPoller 对象，检查 Is_Ready()，失败时应回退到 Epoller。
+ * 2. Get_Event_Data 返回的数据位于缓冲区环中，在下一次 Wait 时归还给内核，调用方须在此之前拷贝。
+ *
+ * 依赖：
+ * - event_backend.h 事件后端接口
+ * - Linux io_uring（5.19 及以上：multishot accept/recv、provided buffer ring、IORING_ENTER_EXT_ARG）
+ *
+ * 路径：webserve/src/uring.cpp
+ */
+#pragma once
+#include"event_backend.h"
+#include<assert.h>
+#include<errno.h>
+#include<vector>
+#include<memory>
+#include<unordered_map>
+
+//linux/io_uring.h 会引入 linux/fs.h 中的 BLOCK_SIZE 等宏，只在 uring.cpp 中包含
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+class UringPoller:public EventBackend{
+    private:
+    //用户数据中的操作类型
+    enum URING_OP:uint64_t{
+        OP_ACCEPT=1,
+        OP_RECV,
+        OP_WRITEV,
+        OP_CANCEL,
+    };
+    //一个完成事件
+    struct uring_event{
+        int fd;
+        uint32_t events;
+        int result;
+        const char* data;
+    };
+    //缓冲区环中缓冲区的数量（2的幂）与单个缓冲区的大小
+    static const unsigned BUFFER_COUNT=512;
+    static const unsigned BUFFER_SIZE=4096;
+    //缓冲区组号
+    static const uint16_t BUFFER_GROUP=0;
+
+    //io_uring 实例的描述符
+    int RingFd_;
+    //初始化是否成功
+    bool ready_;
+    //提交队列与完成队列的映射
+    void* SqRing_;
+    size_t SqRingSize_;
+    void* CqRing_;
+    size_t CqRingSize_;
+    io_uring_sqe* Sqes_;
+    size_t SqesSize_;
+    //提交队列的头尾指针、掩码与索引数组
+    unsigned* SqHead_;
+    unsigned* SqTail_;
+    unsigned SqMask_;
+    unsigned SqEntries_;
+    unsigned* SqArray_;
+    unsigned* SqFlags_;
+    //本地尾指针，Wait时一次性提交
+    unsigned SqLocalTail_;
+    //完成队列的头尾指针、掩码与事件数组
+    unsigned* CqHead_;
+    unsigned* CqTail_;
+    unsigned CqMask_;
+    io_uring_cqe* Cqes_;
+
+    //提供缓冲区环与缓冲区内存
+    io_uring_buf_ring* BufRing_;
+    size_t BufRingSize_;
+    char* Buffers_;
+    //本批事件中交给调用方、下一次Wait时归还的缓冲区
+    std::vector<uint16_t>Lent_;
+    //缓冲区环的本地尾指针
+    uint16_t BufTail_;
+
+    //每个描述符的代数，DelFd后旧请求的完成事件被忽略
+    std::vector<uint32_t>Generation_;
+    //每个描述符是否有已提交、尚未完成的writev
+    std::vector<uint8_t>Writing_;
+    //连接关闭时仍在进行的writev引用的内存，按该writev的用户数据（含旧代数）索引，完成事件到达时释放
+    std::unordered_map<uint64_t,std::shared_ptr<const void>>Retired_;
+    //本批完成事件及其上限
+    std::vector<uring_event>Events_;
+    size_t MaxEvents_;
+
+    //初始化 io_uring 与缓冲区环
+    bool init_ring_(unsigned Entries);
+    bool init_buffer_ring_();
+    //获取一个空闲的提交项，队列满时先提交
+    io_uring_sqe* get_sqe_();
+    //提交本地已准备的提交项，Wait大于0时至少等待一个完成事件
+    int enter_(unsigned WaitNr,int timeoutMs);
+    //把缓冲区bid归还给缓冲区环
+    void recycle_buffer_(uint16_t Bid);
+    //提交 multishot accept / multishot recv
+    bool arm_accept_(int FileD);
+    bool arm_recv_(int FileD);
+    //描述符的当前代数
+    uint32_t generation_(int FileD);
+    //用户数据的编码与解码
+    static uint64_t encode_(URING_OP Op,uint32_t Gen,int FileD);
+    //处理一个完成队列项，产生事件时返回true
+    bool handle_cqe_(const io_uring_cqe& Cqe);
+    //收割完成队列中的完成项
+    void harvest_();
+
+    public:
+    explicit UringPoller(int MaxEvents=1024);
+    ~UringPoller() override;
+    //初始化是否成功
+    bool Is_Ready() const;
+
+    bool AddFd(int FileD,uint32_t Events) override;
+    bool AddListenFd(int FileD,uint32_t Events) override;
+    bool ModFd(int FileD,uint32_t Events) override;
+    bool DelFd(int FileD) override;
+    int Wait(int timeoutMs) override;
+    int Get_Event_FileD(size_t Index) const override;
+    uint32_t Get_Event_events(size_t Index) const override;
+
+    bool Is_Completion_Based() const override;
+    int Get_Event_Result(size_t Index) const override;
+    const char* Get_Event_Data(size_t Index) const override;
+    bool Submit_Writev(int FileD,const iovec* Iov,int Count) override;
+    void Retire_Writev(int FileD,std::shared_ptr<const void> Owner) override;
+};
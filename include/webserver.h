@@ -2,85 +2,103 @@
  * @file webserver.h
  * @brief WebServe - 基于 epoll 和线程池的高性能 HTTP 服务器
  *
- * 该头文件定义了 WebServe 类，封装了基于 epoll 的多路复用、定时器管理、线程池任务调度和 HTTP 连接处理等功能。
+ * 该头文件定义了 WebServe 类，负责服务器的全局配置、资源目录、线程池以及 Reactor 事件循环的创建与启动。
+ * 具体的连接管理与事件处理由 Reactor 完成。
  *
  * ## 主要特性
  * - 支持高并发的 HTTP 连接管理
  * - 使用 epoll 进行高效的 IO 事件监听
- * - 线程池处理请求，提升并发性能
+ * - 单 Reactor 模式：主线程事件循环 + 线程池处理请求
+ * - 多 Reactor 模式：每核一个事件循环，SO_REUSEPORT 分发连接，连接不跨线程
  * - 支持连接定时关闭，防止资源泄漏
  * - 支持自定义事件触发模式（边缘/水平触发）
+ * - 事件后端可在 epoll 与 io_uring 之间选择
+ * - 静态资源的打开文件与元数据缓存（FileCache），由 inotify 或 TTL 失效
+ * - 大文件按阈值使用 sendfile 零拷贝发送
+ * - 支持 HTTP/1.1 流水线请求，排队输出有上限
+ * - 条件 GET（ETag / Last-Modified / 304）与按 MIME 类型配置的 Cache-Control
  *
  * ## 主要成员
- * - `init_socket_()`：初始化监听套接字
- * - `add_client_connection_()`：添加客户端连接
- * - `close_connection_()`：关闭客户端连接
- * - `handle_listen_()`、`handle_read_()`、`handle_write_()`：处理各类 epoll 事件
- * - `on_read_()`、`on_write_()`、`on_process_()`：回调处理客户端请求
- * - `send_error_()`：发送错误响应
- * - `extent_time_()`：延长连接定时器
+ * - `init_event_mode_()`：初始化事件触发模式
+ * - `pin_to_core_()`：将 Reactor 线程绑定到指定核心
+ * - `reactors_`：事件循环集合，单 Reactor 模式下只有一个
  *
  * ## 使用方法
- * 1. 创建 WebServe 实例，传入端口、触发模式、超时时间、延迟关闭选项、线程数等参数
+ * 1. 填写 ServerConfig（main.cpp 从 config.json 读取，没有的键保留默认值），用它创建 WebServe 实例；
+ *    新的配置项作为 ServerConfig 的字段加入，不增加构造函数的参数
  * 2. 调用 `start()` 启动服务器
  *
  * ## 依赖
- * - epoll.h
- * - timer.h
+ * - reactor.h
  * - ThreadPool.h
  * - HttpConnection.h
+ * - file_cache.h
  * @date 2025
  */
 #pragma once
-#include"epoll.h"
-#include"timer.h"
+#include"reactor.h"
 #include"ThreadPool.h"
 #include"HttpConnection.h"
+#include"file_cache.h"
+#include"gzip_cache.h"
 
+#include <vector>
+#include <thread>
+#include <memory>
+#include <string>
 #include <unordered_map>
-#include <fcntl.h>       // fcntl()
-#include <unistd.h>      // close()
+#include <unistd.h>      // getcwd()
+#include <signal.h>      // signal()
+#include <pthread.h>     // pthread_setaffinity_np()
+#include <sched.h>       // cpu_set_t
+#include <algorithm>
 #include <assert.h>
-#include <errno.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
+
+//服务器配置，字段与config.json的键同名，默认值即没有该键时的取值
+struct ServerConfig{
+    //监听端口
+    int port=1234;
+    //0=默认, 1=ET连接, 2=ET监听, 3=全ET
+    int trig_mode=3;
+    //关闭空闲连接的超时时间（毫秒）
+    int timeout_ms=60000;
+    //是否启用SO_LINGER
+    bool opt_linger=false;
+    //线程池的线程数（单Reactor模式）
+    int thread_number=4;
+    //1=单Reactor+线程池, N>1=N个Reactor, 0=每个核心一个Reactor
+    int reactor_count=1;
+    //事件后端："epoll" 或 "io_uring"
+    std::string event_backend="epoll";
+    //静态文件缓存的过期时间（毫秒），0=只依赖inotify失效
+    int file_cache_ttl_ms=0;
+    //不小于该字节数的文件用sendfile发送，0=不使用
+    int sendfile_threshold=65536;
+    //流水线请求排队的响应超过该字节数时暂停解析
+    int pipeline_output_limit=65536;
+    //按MIME类型的Cache-Control max-age（秒），"*"为其余类型的默认值
+    std::unordered_map<std::string,int> cache_max_age;
+    //是否发送预压缩的.br/.gz兄弟文件
+    bool precompressed=true;
+    //动态gzip压缩结果的缓存容量（字节，0=不压缩）与最小压缩长度
+    size_t gzip_cache_size=0;
+    size_t gzip_min_length=256;
+    //读入内存的小文件的长度上限与内存缓存的总字节数（0=全部使用mmap）
+    size_t small_file_max=0;
+    size_t small_file_cache_size=0;
+    //启动预热，以及预先建立页表的映射总字节数上限
+    bool warm_up=false;
+    size_t warm_up_populate_bytes=0;
+    //在内置的MIME类型之外增加或覆盖的后缀
+    std::unordered_map<std::string,std::string> mime_types;
+};
 
 class WebServe{
     private:
-    //初始化套接字
-    bool init_socket_();
-    
     //初始化事件模式，如边缘触发或水平触发
     void init_event_mode_(int trig_mode);
-    
-    //添加客户端连接
-    void add_client_connection_(int fd,sockaddr_in addr);
-    //关闭客户端连接
-    void close_connection_(HttpConnection* client);
-
-    //处理监听事件
-    void handle_listen_();
-    //处理写事件
-    void handle_write_(HttpConnection* client);
-    //处理读事件
-    void handle_read_(HttpConnection* client);
-
-    //读事件回调
-    void on_read_(HttpConnection* client);
-    //写事件回调
-    void on_write_(HttpConnection* client);
-    //处理客户端请求
-    void on_process_(HttpConnection* client);
-
-    //发送错误信息
-    void send_error_(int fd,const char* information);
-    //延长客户端连接的定时器
-    void extent_time_(HttpConnection* client);
-
-    static const int max_fd_=65536;
-    //设置文件描述符为非阻塞模式
-    static int set_fd_nonblock_(int fd);
+    //将线程绑定到指定核心
+    static void pin_to_core_(std::thread& thread,int core);
 
     //服务器监听的端口号
     int port_;    
@@ -88,29 +106,33 @@ class WebServe{
     bool open_linger_;
     //超时时间，单位为毫秒
     int time_out_ms_;
+    //Reactor 数量，小于等于1时为单 Reactor 模式
+    int reactor_count_;
+    //是否为多 Reactor 模式
+    bool multi_reactor_;
     //标记服务器是否关闭
     bool close_or_not_;
-    //监听套接字的文件描述符
-    int listen_fd_;
     //服务器资源目录的路径
     char* srcDir_;
+    //事件后端："epoll" 或 "io_uring"
+    std::string event_backend_;
 
     //监听套接字的事件类型
     uint32_t listen_event_;
     //连接套接字的事件类型
     uint32_t connection_event_;
     
-    //定时器管理器，用于处理超时事件
-    std::unique_ptr<TimerManager>timer_;
-    //线程池，用于处理任务
+    //线程池，用于处理任务，仅单 Reactor 模式使用
     std::unique_ptr<CoroutineThreadPool> m_threadpool_;
-    //epoll 实例，用于IO多路复用
-    std::unique_ptr<Epoller>epoller_;
-    //存储所有客户端连接的映射
-    std::unordered_map<int,HttpConnection>users_;
+    //多 Reactor 模式下执行动态压缩的线程池（单 Reactor 模式使用 m_threadpool_）
+    std::unique_ptr<CoroutineThreadPool> compress_pool_;
+    //事件循环集合
+    std::vector<std::unique_ptr<Reactor>>reactors_;
+    //多 Reactor 模式下运行事件循环的线程
+    std::vector<std::thread>reactor_threads_;
 
     public:
-    WebServe(int port,int trig_mode,int timeout_ms,bool opt_linger,int thread_number);
+    explicit WebServe(const ServerConfig& config);
     ~WebServe();
     void start();
-};
\ No newline at end of file
+};
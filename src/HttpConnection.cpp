@@ -3,29 +3,55 @@
 const char* HttpConnection::srcDir;
 std::atomic<size_t>HttpConnection::user_count;
 bool HttpConnection::isEt;
+size_t HttpConnection::sendfile_threshold=64*1024;
+size_t HttpConnection::pipeline_output_limit=64*1024;
 HttpConnection::HttpConnection() { 
     fd_=-1;
     addr_={0};
     close_or_not=true;
+    use_sendfile_=true;
+    keep_alive_=false;
+    coroutine_=nullptr;
+    waiting_events_=0;
+    dispatch_state_=DISPATCH_IDLE;
 };
 HttpConnection::~HttpConnection() { 
     close_httpconnection(); 
 };
-void HttpConnection::init_httpconnection(int fd,const sockaddr_in& addr){
+void HttpConnection::init_httpconnection(int fd,const sockaddr_in& addr,bool use_sendfile){
     assert(fd>0);
     user_count++;
     addr_=addr;
     fd_=fd;
+    use_sendfile_=use_sendfile;
+    output_.Clear();
+    take_ownership();
     write_buffer_.Init_Buffer();
     read_buffer_.Init_Buffer();
+    request_.Init();
+    keep_alive_=false;
+    dispatch_state_=DISPATCH_IDLE;
     close_or_not=false;
 }
 void HttpConnection::close_httpconnection(){
     response_.unmap_File();
+    if(coroutine_){
+        //调用方保证协程停在挂起点上且没有投递给其它线程（空闲，或由恢复它的线程交还），此时销毁协程帧是安全的
+        coroutine_.destroy();
+        coroutine_=nullptr;
+        waiting_events_=0;
+    }
     if(close_or_not==false){
         close_or_not=true;
         user_count--;
         close(fd_);
+        //关闭连接的一方(可能是定时器所在的线程)接管缓冲区，丢弃未处理的数据并归还存储块
+        take_ownership();
+        read_buffer_.Init_Buffer();
+        read_buffer_.Release();
+        write_buffer_.Init_Buffer();
+        output_.Clear();
+        write_buffer_.Release();
     }
 }
 int HttpConnection::get_Fd() const {
@@ -60,68 +86,193 @@ ssize_t HttpConnection::read_buffer(int* save_erron){
 ssize_t HttpConnection::write_buffer(int* save_erron){
     ssize_t length=-1;
     do{
-        length=writev(fd_,iov_,iov_count_);
+        if(output_.Size()==0){
+            //所有数据都已写入
+            break;
+        }
+        //连续的内存段一次writev（后面还有文件段时sendmsg+MSG_MORE），文件段用sendfile，EAGAIN后从中断处继续
+        length=output_.Send(fd_,save_erron);
         if(length<0){
             //写入长度小于0，表示出现错误
-            *save_erron=errno;
-            break;
-        }else if(iov_[0].iov_len+iov_[1].iov_len==0){
-            //所有数据都已写入
             break;
-        }else if (static_cast<size_t>(length)>iov_[0].iov_len){
-            //写入的数据超过了第一个缓冲区的长度，调整第二个缓冲区的指针和长度
-            iov_[1].iov_base=(uint8_t*)iov_[1].iov_base+(length-iov_[0].iov_len);
-            iov_[1].iov_len-=(length-iov_[0].iov_len);
-            if(iov_[0].iov_len){
-                //第一个缓冲区还有数据未写入
-                write_buffer_.Init_Buffer();
-                iov_[0].iov_len=0;
-            }
-        }else{
-            //如果写入的数据没有超过第一个缓冲区的长度，调整第一个缓冲区的指针和长度
-            iov_[0].iov_base=(uint8_t*)iov_[0].iov_base+length;
-            iov_[0].iov_len-=length;
-            write_buffer_.Update_ReadPos(length);
         }
-    }while(isEt||get_write_length()>10240);
+        update_iov(length);
+    }while(get_write_length()>0&&(isEt||get_write_length()>10240));
     return length;
 }
+void HttpConnection::update_iov(size_t length){
+    //各段记录自己的进度，写缓冲区中的段写出后推进写缓冲区的读位置
+    output_.Consume(length);
+    if(get_write_length()==0){
+        //响应已全部写出：把写缓冲区的存储块还给池
+        write_buffer_.Release();
+    }
+}
+void HttpConnection::fill_read_buffer(const char* data,size_t length){
+    read_buffer_.Write_to_Buffer(data,length);
+}
+bool HttpConnection::try_io_(uint32_t events,int* save_erron,ssize_t* result){
+    *save_erron=0;
+    if(events==EPOLLIN){
+        size_t before=read_buffer_.How_Many_Bytes_We_Need_Read();
+        ssize_t length=read_buffer(save_erron);
+        size_t got=read_buffer_.How_Many_Bytes_We_Need_Read()-before;
+        if(got>0){
+            //边缘触发模式下会一直读到EAGAIN，只要读到了数据就不挂起
+            *save_erron=0;
+            *result=got;
+            return true;
+        }
+        *result=length;
+        return length==0||*save_erron!=EAGAIN;
+    }
+    *result=write_buffer(save_erron);
+    if(get_write_length()==0){
+        return true;
+    }
+    //EAGAIN，或水平触发模式下只写一部分：等待可写
+    return *result<0&&*save_erron!=EAGAIN;
+}
+void HttpConnection::attach_coroutine(IoCoroutine co){
+    if(coroutine_){
+        coroutine_.destroy();
+    }
+    coroutine_=co.Release();
+    waiting_events_=0;
+}
+bool HttpConnection::resume_coroutine(){
+    if(!coroutine_||coroutine_.done()){
+        return false;
+    }
+    //可能在与上一次不同的线程上恢复
+    take_ownership();
+    coroutine_.resume();
+    return !coroutine_.done();
+}
+void HttpConnection::take_ownership(){
+    read_buffer_.Take_Ownership();
+    write_buffer_.Take_Ownership();
+}
+HttpConnection::MemoryStats HttpConnection::get_memory_stats() const{
+    return MemoryStats{read_buffer_.Capacity(),write_buffer_.Capacity()};
+}
+std::shared_ptr<const void> HttpConnection::release_output(){
+    if(output_.Size()==0){
+        return nullptr;
+    }
+    //段与iovec随队列移动，写缓冲区的存储块交换出去，已提交的writev引用的内存都保持原地址
+    auto released=std::make_shared<ReleasedOutput_>();
+    released->Output=std::move(output_);
+    output_.Clear();
+    released->Write_Buffer.Swap(write_buffer_);
+    return released;
+}
+uint32_t HttpConnection::get_waiting_events() const{
+    return waiting_events_;
+}
+bool HttpConnection::try_dispatch(){
+    uint32_t state=dispatch_state_.load(std::memory_order_acquire);
+    for(;;){
+        if(state&DISPATCH_CLOSING){
+            return false;
+        }
+        //空闲：标记为运行中；运行中：记下这次事件，由正在运行的线程再恢复一次
+        uint32_t next=state==DISPATCH_IDLE?DISPATCH_RUNNING:(state|DISPATCH_PENDING);
+        if(dispatch_state_.compare_exchange_weak(state,next,std::memory_order_acq_rel)){
+            return state==DISPATCH_IDLE;
+        }
+    }
+}
+uint32_t HttpConnection::finish_dispatch(){
+    uint32_t state=DISPATCH_RUNNING;
+    if(dispatch_state_.compare_exchange_strong(state,DISPATCH_IDLE,std::memory_order_acq_rel)){
+        return 0;
+    }
+    if(!(state&DISPATCH_CLOSING)){
+        //有DISPATCH_PENDING：取走它，继续运行（期间可能又请求了关闭）
+        state=dispatch_state_.fetch_and(~DISPATCH_PENDING,std::memory_order_acq_rel);
+    }
+    return (state&DISPATCH_CLOSING)?DISPATCH_CLOSING:DISPATCH_PENDING;
+}
+bool HttpConnection::request_close(){
+    return dispatch_state_.fetch_or(DISPATCH_CLOSING,std::memory_order_acq_rel)==DISPATCH_IDLE;
+}
+bool HttpConnection::is_closing() const{
+    return dispatch_state_.load(std::memory_order_acquire)&DISPATCH_CLOSING;
+}
+const struct iovec* HttpConnection::get_iov(int* count){
+    return output_.Build_Iov(count);
+}
 int HttpConnection::get_write_length(){
-    return iov_[1].iov_len+iov_[0].iov_len;
+    return output_.Size();
 }
 bool HttpConnection::get_alive_status() const{
-    return request_.Are_You_Keep_Alive();
+    return keep_alive_;
 }
 bool HttpConnection::handle_httpconnection(){
-    request_.Init();
-    if(read_buffer_.How_Many_Bytes_We_Need_Read()<=0){
-        //没有需要读取的字节，返回false
-        return false; 
-    }else if(request_.Parse(read_buffer_)){ 
-        //解析成功，初始化响应对象为200 OK
-        response_.Init(srcDir,request_.Path(),request_.Are_You_Keep_Alive(),200);
-    }else{
-        //解析失败，初始化响应对象为400 Bad Request
-        response_.Init(srcDir,request_.Path(),false,400);
+    bool queued=false;
+    //流水线：依次处理读缓冲区中所有完整的请求，响应按顺序加入输出队列，之后一次写出；
+    //已排队的数据超过pipeline_output_limit时停止解析，等它们写出后再继续
+    while(!queued||output_.Size()<pipeline_output_limit){
+        if(request_.Is_Finished()){
+            //上一个请求已经处理完，开始解析新的请求；否则从上次停下的位置继续解析
+            request_.Init();
+        }
+        if(read_buffer_.How_Many_Bytes_We_Need_Read()<=0){
+            //没有需要读取的字节：把读缓冲区的存储块还给池（空闲的长连接不占用缓冲区）
+            read_buffer_.Release();
+            break;
+        }
+        HttpRequest::HTTP_CODE code=request_.Parse(read_buffer_);
+        if(code==HttpRequest::NO_REQUEST){
+            //请求还不完整，保留解析进度，继续等待数据
+            break;
+        }else if(code==HttpRequest::GET_REQUEST){ 
+            //解析成功，初始化响应对象为200 OK
+            keep_alive_=request_.Are_You_Keep_Alive();
+            if(request_.Method()=="GET"){
+                //条件GET、Range与预压缩：由响应根据文件的验证器、大小与预压缩版本决定发送的内容
+                HttpResponse::Conditions conditions{request_.Header("If-None-Match"),request_.Header("If-Modified-Since"),
+                                                    request_.Header("Range"),request_.Header("If-Range"),
+                                                    request_.Header("Accept-Encoding")};
+                response_.Init(srcDir,request_.Path(),keep_alive_,200,conditions);
+            }else{
+                response_.Init(srcDir,request_.Path(),keep_alive_,200);
+            }
+        }else{
+            //解析失败，初始化响应对象为400 Bad Request
+            keep_alive_=false;
+            response_.Init(srcDir,request_.Path(),false,400);
+        }
+        queue_response_();
+        queued=true;
+        if(!keep_alive_){
+            //响应后关闭连接，之后的请求不再处理
+            break;
+        }
     }
-    //生成响应并将其写入write_buffer_
-    response_.make_Response(write_buffer_);
-
-    //设置第一个iovec的基地址为write_buffer_的读取位置
-    iov_[0].iov_base=const_cast<char*>(write_buffer_.Where_Did_We_Read());
-    //设置第一个iovec的长度为write_buffer_中需要读取的字节数
-    iov_[0].iov_len=write_buffer_.How_Many_Bytes_We_Need_Read();
-    //设置iovec计数为1
-    iov_count_=1; 
-
-    if(response_.file_Length()>0&&response_.file()){ 
-        //响应中有文件内容
-        //设置第二个iovec的基地址为响应文件的地址
-        iov_[1].iov_base=response_.file();
-        //设置第二个iovec的长度为文件长度
-        iov_[1].iov_len=response_.file_Length();
-        //设置iovec计数为2
-        iov_count_=2;
+    return queued;
+}
+void HttpConnection::queue_response_(){
+    //生成响应：预先生成的响应头按引用加入输出队列（持有缓存项），其余内容在write_buffer_中，作为写缓冲区中的段加入
+    size_t pending=write_buffer_.How_Many_Bytes_We_Need_Read();
+    const std::string* header=response_.make_Response(write_buffer_);
+    size_t written=write_buffer_.How_Many_Bytes_We_Need_Read()-pending;
+    if(header){
+        output_.Append(header->data(),header->size(),response_.file_Ref());
     }
-    return true;
-};
+    //文件区间：每段之前是写缓冲区中的分段头；区间段持有缓存文件的引用，流水线中后面的响应不会使前面的映射失效
+    for(const HttpResponse::Extent& extent:response_.extents()){
+        output_.Append_Buffer(write_buffer_,extent.Prefix);
+        written-=extent.Prefix;
+        if(use_sendfile_&&sendfile_threshold>0&&extent.Length>=sendfile_threshold&&response_.file_Fd()>=0){
+            //大区间：用sendfile发送，避免缺页与用户态拷贝
+            output_.Append_File(response_.file_Fd(),extent.Offset,extent.Length,response_.file_Ref());
+        }else{
+            //直接引用内存映射中的区间，不拷贝
+            output_.Append(response_.file()+extent.Offset,extent.Length,response_.file_Ref());
+        }
+    }
+    //错误页面或多段响应的结束分隔符
+    output_.Append_Buffer(write_buffer_,written);
+}
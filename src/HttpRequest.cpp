@@ -1,112 +1,196 @@
 #include"HttpRequest.h"
-const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML_{
-    "/index", "/welcome", "/video", "/picture"
+const std::string_view HttpRequest::DEFAULT_HTML_[][2]={
+    {"/",        "/index.html"},
+    {"/index",   "/index.html"},
+    {"/welcome", "/welcome.html"},
+    {"/video",   "/video.html"},
+    {"/picture", "/picture.html"},
 };
-bool HttpRequest::Parse_Request_Line_(const std::string& Line){
-    /*定义一个正则表达式模式，用于匹配 HTTP 请求行
-    ^: 匹配字符串的开始。
-    ([^ ]*): 匹配不包含空格的任意字符序列，即方法。
-    : 匹配一个空格。
-    ([^ ]*): 匹配不包含空格的任意字符序列，即路径。
-    HTTP/: 匹配字符串 " HTTP/"。
-    ([^ ]*): 匹配不包含空格的任意字符序列，即版本。
-    $: 匹配字符串的结束*/
-    std::regex Patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    //存储正则表达式匹配的结果
-    std::smatch SubMatch;
-    if(regex_match(Line, SubMatch, Patten)){
-        Method_=SubMatch[1];
-        Path_=SubMatch[2];
-        Version_=SubMatch[3];
-        State_=HEADERS;
-        return true;
-    }
-    return false;
-}
-void HttpRequest::Parse_Reauest_Header_(const std::string& Line){
-    /*用于匹配 HTTP 请求头部中的键值对
-    ^：行开始。
-    ([^:]*)：匹配冒号之前的所有字符，即头部字段的键，但不包括冒号。* 表示匹配0或多个字符。
-    :：匹配冒号。
-    ?：匹配0或1个空格，允许冒号后有空格。
-    (.*)：匹配冒号之后的所有字符，即头部字段的值，直到行尾。* 表示匹配0或多个字符。
-    $：行结束*/
-    std::regex Patten("^([^:]*): ?(.*)$");
-    std::smatch SubMatch;
-    if(regex_match(Line,SubMatch,Patten)){
-        Header_[SubMatch[1]]=SubMatch[2];
-    }else{
-        State_=BODY;
+HttpRequest::HttpRequest(){
+    Init();
+}
+std::string_view HttpRequest::View_(const Token_& Token) const{
+    if(Token.Length==0){
+        return std::string_view();
     }
+    return std::string_view(Base_+Token.Offset,Token.Length);
 }
-void HttpRequest::Parse_Data_Body_(const std::string& Line){
-    //将输入的行设置为请求体内容
-    Body_=Line;
-    Parse_Post_();
-    State_=FINISH;
+HttpRequest::Token_ HttpRequest::Make_Token_(const char* Begin,const char* End) const{
+    return Token_{static_cast<uint32_t>(Begin-Base_),static_cast<uint32_t>(End-Begin)};
 }
-void HttpRequest::Parse_Path_(){
-    //检查请求路径是否为根路径(“/”)
-    if(Path_=="/"){
-        //如果是根路径，将 Path_ 修改为 /index.html
-        Path_="/index.html";
+bool HttpRequest::Equal_Ignore_Case_(std::string_view Lhs,std::string_view Rhs){
+    if(Lhs.size()!=Rhs.size()){
+        return false;
+    }
+    for(size_t i=0;i<Lhs.size();++i){
+        //ASCII字母按位或0x20即为小写
+        char a=Lhs[i],b=Rhs[i];
+        if(a!=b&&((a|0x20)!=(b|0x20)||(a|0x20)<'a'||(a|0x20)>'z')){
+            return false;
+        }
+    }
+    return true;
+}
+bool HttpRequest::Parse_Request_Line_(const char* Begin,const char* End){
+    /*请求行格式：方法 SP 请求目标 SP HTTP/版本
+    方法与请求目标中不能包含空格，版本前必须是"HTTP/"*/
+    const char* Method_End=static_cast<const char*>(memchr(Begin,' ',End-Begin));
+    if(!Method_End||Method_End==Begin){
+        return false;
+    }
+    const char* Target_Begin=Method_End+1;
+    const char* Target_End=static_cast<const char*>(memchr(Target_Begin,' ',End-Target_Begin));
+    if(!Target_End||Target_End==Target_Begin){
+        return false;
+    }
+    const char* Version_Begin=Target_End+1;
+    if(End-Version_Begin<=5||memcmp(Version_Begin,"HTTP/",5)!=0){
+        return false;
+    }
+    Version_Begin+=5;
+    if(memchr(Version_Begin,' ',End-Version_Begin)){
+        return false;
+    }
+    Method_=Make_Token_(Begin,Method_End);
+    Target_=Make_Token_(Target_Begin,Target_End);
+    Version_=Make_Token_(Version_Begin,End);
+    //请求路径不包含查询串
+    const char* Query=static_cast<const char*>(memchr(Target_Begin,'?',Target_End-Target_Begin));
+    Path_=Make_Token_(Target_Begin,Query?Query:Target_End);
+    return true;
+}
+bool HttpRequest::Parse_Request_Header_(const char* Begin,const char* Colon,const char* End){
+    /*请求头格式：名称 ":" OWS 值 OWS
+    名称不能为空且不能包含空白，值两端的空格与制表符被去掉*/
+    if(!Colon||Colon==Begin){
+        return false;
+    }
+    if(Colon[-1]==' '||Colon[-1]=='\t'){
+        return false;
+    }
+    if(Header_Count_>=MAX_HEADERS_){
+        return false;
+    }
+    const char* Value_Begin=Colon+1;
+    const char* Value_End=End;
+    while(Value_Begin<Value_End&&(*Value_Begin==' '||*Value_Begin=='\t')){
+        ++Value_Begin;
+    }
+    while(Value_End>Value_Begin&&(Value_End[-1]==' '||Value_End[-1]=='\t')){
+        --Value_End;
+    }
+    Header_Name_[Header_Count_]=Make_Token_(Begin,Colon);
+    Header_Value_[Header_Count_]=Make_Token_(Value_Begin,Value_End);
+    ++Header_Count_;
+    return true;
+}
+bool HttpRequest::Finish_Headers_(){
+    //请求体长度
+    std::string_view Length=Header("Content-Length");
+    Content_Length_=0;
+    for(char ch:Length){
+        if(ch<'0'||ch>'9'){
+            return false;
+        }
+        Content_Length_=Content_Length_*10+(ch-'0');
+        if(Content_Length_>MAX_BODY_BYTES_){
+            return false;
+        }
+    }
+    //HTTP/1.1默认保持连接，除非Connection: close；HTTP/1.0只有显式keep-alive才保持
+    std::string_view Connection=Header("Connection");
+    if(View_(Version_)=="1.1"){
+        Keep_Alive_=!Equal_Ignore_Case_(Connection,"close");
     }else{
-        //遍历DEFAULT_HTML_
-        for(auto &item:DEFAULT_HTML_){
-            if (item==Path_)
-            {
-                //成功匹配后请求路径后添加 .html 扩展名
-                Path_=Path_+".html";
-                break;
+        Keep_Alive_=Equal_Ignore_Case_(Connection,"keep-alive");
+    }
+    return true;
+}
+bool HttpRequest::Next_Line_End_(size_t Size,size_t& Line_End){
+    while(true){
+        if(Delim_Head_==Delim_Count_){
+            //当前一批分隔符已处理完，从上次扫描结束的位置继续扫描，已扫描过的字节不再重复扫描
+            Delim_Head_=0;
+            Delim_Count_=DelimiterScanner::Scan(Base_,Scan_,Size,Delims_,DELIM_CAPACITY_);
+            if(Delim_Count_==0){
+                return false;
             }
         }
+        size_t Offset=Delims_[Delim_Head_++];
+        char ch=Base_[Offset];
+        if(ch=='\n'){
+            Line_End=Offset;
+            return true;
+        }
+        if(ch==':'&&Colon_==NO_COLON_){
+            Colon_=Offset;
+        }
+        //CR在取得整行后去掉
+    }
+}
+void HttpRequest::Parse_Path_(){
+    std::string_view Path=View_(Path_);
+    //遍历DEFAULT_HTML_
+    for(auto& item:DEFAULT_HTML_){
+        if(item[0]==Path){
+            //成功匹配后改写为完整的 .html 路径（静态字符串，不分配内存）
+            Path_Alias_=item[1];
+            break;
+        }
     }
 }
 void HttpRequest::Parse_Post_(){
-    if(Method_=="POST"&&Header_["Connect-Type"]=="application/x-www-from-urlencoded"){
+    if(View_(Method_)!="POST"||!Equal_Ignore_Case_(Header("Content-Type"),"application/x-www-form-urlencoded")){
         // 检查请求方法是否为 POST 以及内容类型是否为 application/x-www-form-urlencoded
-        if(Body_.size()==0){
-            //如果请求体为空，则直接返回
-            return; 
-        }
-        std::string key,value;
-        int num=0;
-        int n=Body_.size();
-        int i=0,j=0;
-        for(;i<n;i++){
-            char ch=Body_[i];
-            switch (ch){
-            case '=':
-                key=Body_.substr(j,i-j); //提取键
-                j=i+1;
-                break;
-            case '+':
-                Body_[i]=' '; //将 '+' 转换为空格
-                break;
-            case '%':
-                //解码URL编码的字符
-                num=Convert_Hex(Body_[i+1])*16+Convert_Hex(Body_[i+2]);
-                Body_[i]=num;
-                //跳过已解码的字符
-                i=i+2; 
-                break;
-            case '&':
-                //提取值
-                value = Body_.substr(j,i-j); 
-                j=i+1;
-                //将键值对存储到Post_ map中
-                Post_[key] = value; 
-                break;
-            default:
+        return;
+    }
+    if(Body_.Length==0){
+        //如果请求体为空，则直接返回
+        return;
+    }
+    //解码需要修改内容，POST表单不在常规路径上，拷贝一份
+    std::string Body(View_(Body_));
+    std::string key,value;
+    int num=0;
+    int n=Body.size();
+    int i=0,j=0;
+    for(;i<n;i++){
+        char ch=Body[i];
+        switch (ch){
+        case '=':
+            key=Body.substr(j,i-j); //提取键
+            j=i+1;
+            break;
+        case '+':
+            Body[i]=' '; //将 '+' 转换为空格
+            break;
+        case '%':
+            //解码URL编码的字符
+            if(i+2>=n){
                 break;
             }
+            num=Convert_Hex(Body[i+1])*16+Convert_Hex(Body[i+2]);
+            Body[i]=num;
+            //去掉已解码的两个字符
+            Body.erase(i+1,2);
+            n-=2;
+            break;
+        case '&':
+            //提取值
+            value = Body.substr(j,i-j);
+            j=i+1;
+            //将键值对存储到Post_ map中
+            Post_[key] = value;
+            break;
+        default:
+            break;
         }
-        assert(j<=i);
-        if(Post_.count(key)==0&&j<i){
-            //处理最后一个键值对（如果存在）
-            value=Body_.substr(j,i-j);
-            Post_[key]=value;
-        }
+    }
+    assert(j<=i);
+    if(Post_.count(key)==0&&j<i){
+        //处理最后一个键值对（如果存在）
+        value=Body.substr(j,i-j);
+        Post_[key]=value;
     }
 }
 int HttpRequest::Convert_Hex(char ch){
@@ -116,63 +200,109 @@ int HttpRequest::Convert_Hex(char ch){
     return ch;
 }
 void HttpRequest::Init() {
-    Method_ = Path_ = Version_ = Body_ = "";
     //初始化解析到行状态
     State_=REQUEST_LINE;
+    Base_=nullptr;
+    Scan_=Line_Start_=0;
+    Delim_Head_=Delim_Count_=0;
+    Colon_=NO_COLON_;
+    Method_=Target_=Version_=Body_=Path_=Token_{0,0};
+    Path_Alias_=std::string_view();
+    Header_Count_=0;
+    Content_Length_=0;
+    Keep_Alive_=false;
     //清空容器
-    Header_.clear();
-    //清空容器
-    Post_.clear();
-}
-bool HttpRequest::Parse(Buffer& Buff){
-    //常量字符数组，用于表示 HTTP 中的回车换行符，这是 HTTP 协议中用于分隔请求行的标准分隔符
-    const char CRLF[]="\r\n";
-    //缓冲区无数据则直接返回false
-    if(Buff.How_Many_Bytes_We_Need_Read()<=0){
-        return false;
+    if(!Post_.empty()){
+        Post_.clear();
     }
-    //缓冲区可读数据非０且状态不是结束则保持循环
-    while(Buff.How_Many_Bytes_We_Need_Read()&&State_!=FINISH){
-        //使用search查找缓冲区中下一个 CRLF（回车换行符）的位置
-        const char* Line_End =std::search(Buff.Where_Did_We_Read(),Buff.Where_Did_We_Write_Const(),CRLF,CRLF+2);
-        //从当前读取指针到行结束位置提取出一行数据，存储在 line 字符串中
-        std::string Line(Buff.Where_Did_We_Read(),Line_End);
+}
+HttpRequest::HTTP_CODE HttpRequest::Parse(Buffer& Buff){
+    //偏移相对于读指针，每次解析时重新取得基址（缓冲区扩容后地址会变化）
+    Base_=Buff.Where_Did_We_Read();
+    const size_t Size=Buff.How_Many_Bytes_We_Need_Read();
+    while(State_!=FINISH){
+        if(State_==BODY){
+            //请求体按Content-Length接收完整
+            if(Size-Line_Start_<Content_Length_){
+                return NO_REQUEST;
+            }
+            Body_=Token_{static_cast<uint32_t>(Line_Start_),static_cast<uint32_t>(Content_Length_)};
+            Line_Start_+=Content_Length_;
+            State_=FINISH;
+            break;
+        }
+        size_t Line_End=0;
+        if(!Next_Line_End_(Size,Line_End)){
+            //请求行与请求头过长
+            return Size>MAX_HEADER_BYTES_?BAD_REQUEST:NO_REQUEST;
+        }
+        const char* Begin=Base_+Line_Start_;
+        const char* End=Base_+Line_End;
+        const char* Colon=Colon_==NO_COLON_?nullptr:Base_+Colon_;
+        if(End>Begin&&End[-1]=='\r'){
+            //去掉行尾的CR
+            --End;
+        }
+        Line_Start_=Line_End+1;
+        Colon_=NO_COLON_;
         //根据当前的解析状态State_，执行不同的解析函数
         switch(State_){
             case REQUEST_LINE:
-                if(!Parse_Request_Line_(Line)){
-                    return false;
-                }Parse_Path_();
+                if(Begin==End){
+                    //忽略请求行之前的空行
+                    break;
+                }
+                if(!Parse_Request_Line_(Begin,End)){
+                    return BAD_REQUEST;
+                }
+                State_=HEADERS;
                 break;
             case HEADERS:
-                Parse_Reauest_Header_(Line);
-                if(Buff.How_Many_Bytes_We_Need_Read()<=2){
-                    State_=FINISH;
-                }break;
-            case BODY:
-                Parse_Data_Body_(Line);
+                if(Begin==End){
+                    //空行：请求头结束
+                    if(!Finish_Headers_()){
+                        return BAD_REQUEST;
+                    }
+                    State_=Content_Length_>0?BODY:FINISH;
+                    //请求体不再扫描，丢弃扫描器可能已越过请求头结尾找到的分隔符
+                    Delim_Head_=Delim_Count_=0;
+                    Scan_=Line_Start_;
+                }else if(!Parse_Request_Header_(Begin,Colon,End)){
+                    return BAD_REQUEST;
+                }
                 break;
             default:
                 break;
-        }//如果行结束指针等于缓冲区的写入指针，说明已经到达缓冲区末尾，跳出循环
-        if(Line_End==Buff.Where_Did_We_Write()){
-            break;
         }
-        //更新缓冲区的读取指针，跳过当前行和 CRLF
-        Buff.Update_ReadPos(Line_End+2);
-    }return true;
+    }
+    Parse_Path_();
+    Parse_Post_();
+    //完整的请求从缓冲区中消费，视图指向的内存在下一次写入前保持不变
+    Buff.Update_ReadPos(Line_Start_);
+    return GET_REQUEST;
+}
+bool HttpRequest::Is_Finished() const {
+    return State_==FINISH;
 }
-std::string HttpRequest::Path() const {
-    return Path_;
+std::string_view HttpRequest::Path() const {
+    if(!Path_Alias_.empty()){
+        return Path_Alias_;
+    }
+    return View_(Path_);
 }
-std::string& HttpRequest::Path(){
-    return Path_;
+std::string_view HttpRequest::Method() const {
+    return View_(Method_);
 }
-std::string HttpRequest::Method() const {
-    return Method_;
+std::string_view HttpRequest::Version() const {
+    return View_(Version_);
 }
-std::string HttpRequest::Version() const {
-    return Version_;
+std::string_view HttpRequest::Header(std::string_view Key) const {
+    for(size_t i=0;i<Header_Count_;++i){
+        if(Equal_Ignore_Case_(View_(Header_Name_[i]),Key)){
+            return View_(Header_Value_[i]);
+        }
+    }
+    return std::string_view();
 }
 std::string HttpRequest::Get_Post(const std::string& key) const {
     assert(key!="");
@@ -189,10 +319,5 @@ std::string HttpRequest::Get_Post(const char* key) const {
     return "";
 }
 bool HttpRequest::Are_You_Keep_Alive() const {
-    //返回具有指定键的元素数量
-    if(Header_.count("Connection")==1){
-        return Header_.find("Connection")->second =="keep-aliv"&& Version_=="1.1";
-    }else{
-        return false;
-    }
-}
\ No newline at end of file
+    return Keep_Alive_;
+}
@@ -1,163 +1,569 @@
 #include"HttpResponse.h"
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/msword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css"}, 
-    { ".js",    "text/javascript"},
+#include<ctime>
+#include<strings.h>
+#include<iterator>
+#include<stdexcept>
+//内置的文件后缀与MIME类型，每项是后缀与预先生成的Content-Type响应头行
+static constexpr MimeTable::Entry BUILTIN_MIME_TYPES[]={
+    { ".html",  "Content-Type: text/html\r\n" },
+    { ".xml",   "Content-Type: text/xml\r\n" },
+    { ".xhtml", "Content-Type: application/xhtml+xml\r\n" },
+    { ".txt",   "Content-Type: text/plain\r\n" },
+    { ".rtf",   "Content-Type: application/rtf\r\n" },
+    { ".pdf",   "Content-Type: application/pdf\r\n" },
+    { ".word",  "Content-Type: application/msword\r\n" },
+    { ".png",   "Content-Type: image/png\r\n" },
+    { ".gif",   "Content-Type: image/gif\r\n" },
+    { ".jpg",   "Content-Type: image/jpeg\r\n" },
+    { ".jpeg",  "Content-Type: image/jpeg\r\n" },
+    { ".au",    "Content-Type: audio/basic\r\n" },
+    { ".mpeg",  "Content-Type: video/mpeg\r\n" },
+    { ".mpg",   "Content-Type: video/mpeg\r\n" },
+    { ".avi",   "Content-Type: video/x-msvideo\r\n" },
+    { ".gz",    "Content-Type: application/x-gzip\r\n" },
+    { ".tar",   "Content-Type: application/x-tar\r\n" },
+    { ".css",   "Content-Type: text/css\r\n" },
+    { ".js",    "Content-Type: text/javascript\r\n" },
 };
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
-    { 200, "OK" },
-    { 400, "Bad Request" },
-    { 403, "Forbidden" },
-    { 404, "Not Found" },
-};
-const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
-    { 400, "/400.html" },
-    { 403, "/403.html" },
-    { 404, "/404.html" },
+//编译期生成的完美哈希表，生成失败（后缀重复）时编译不通过
+static constexpr MimeTable BUILTIN_MIME(BUILTIN_MIME_TYPES,std::size(BUILTIN_MIME_TYPES));
+static_assert(BUILTIN_MIME.Valid(),"duplicate suffix in BUILTIN_MIME_TYPES");
+static_assert(BUILTIN_MIME.Find(".CSS")->Type()=="text/css");
+//没有后缀或后缀不在表中时的类型
+static constexpr MimeTable::Entry DEFAULT_MIME={ "", "Content-Type: text/plain\r\n" };
+//状态码、原因短语、预先生成的状态行与错误页面路径
+static constexpr StatusTable::Entry STATUS_ENTRIES[]={
+    { 200, "OK",                    "HTTP/1.1 200 OK\r\n",                    "" },
+    { 206, "Partial Content",       "HTTP/1.1 206 Partial Content\r\n",       "" },
+    { 304, "Not Modified",          "HTTP/1.1 304 Not Modified\r\n",          "" },
+    { 400, "Bad Request",           "HTTP/1.1 400 Bad Request\r\n",           "/400.html" },
+    { 403, "Forbidden",             "HTTP/1.1 403 Forbidden\r\n",             "/403.html" },
+    { 404, "Not Found",             "HTTP/1.1 404 Not Found\r\n",             "/404.html" },
+    { 416, "Range Not Satisfiable", "HTTP/1.1 416 Range Not Satisfiable\r\n", "" },
 };
+static constexpr StatusTable STATUS(STATUS_ENTRIES,std::size(STATUS_ENTRIES));
+static_assert(STATUS.Find(404)->Error_Page=="/404.html"&&STATUS.Find(500)==nullptr);
+
+const MimeTable* HttpResponse::MIME_=&BUILTIN_MIME;
+std::unique_ptr<MimeTable> HttpResponse::CUSTOM_MIME_;
+std::vector<std::string> HttpResponse::MIME_STRINGS_;
+std::unordered_map<std::string, int> HttpResponse::MAX_AGE;
+
+void HttpResponse::set_Cache_Control(const std::unordered_map<std::string,int>& Max_Age){
+    MAX_AGE=Max_Age;
+}
+size_t HttpResponse::set_Mime_Types(const std::unordered_map<std::string,std::string>& Types){
+    //先回到内置表，旧的自定义表与字符串在重新生成之后才释放
+    MIME_=&BUILTIN_MIME;
+    if(Types.empty()){
+        CUSTOM_MIME_.reset();
+        MIME_STRINGS_.clear();
+        return BUILTIN_MIME.Size();
+    }
+    //配置的后缀覆盖内置的同名后缀（不区分大小写）
+    std::vector<std::pair<std::string,std::string>> merged;
+    for(const auto& [suffix,type]:Types){
+        if(suffix.empty()||type.empty()||type.find_first_of("\r\n")!=std::string::npos||
+           suffix.find_first_of("\r\n/")!=std::string::npos){
+            throw std::invalid_argument("mime_types: invalid entry \""+suffix+"\"");
+        }
+        std::string key=suffix.front()=='.'?suffix:"."+suffix;
+        //"svg"与".svg"、".SVG"与".svg"是同一个后缀：类型相同时只保留一项，不同时无法确定用哪个
+        bool duplicate=false;
+        for(const auto& custom:merged){
+            if(strcasecmp(custom.first.c_str(),key.c_str())!=0){
+                continue;
+            }
+            if(custom.second!=type){
+                throw std::invalid_argument("mime_types: duplicate suffix \""+key+"\" with different types \""+
+                                            custom.second+"\" and \""+type+"\"");
+            }
+            duplicate=true;
+        }
+        if(!duplicate){
+            merged.emplace_back(std::move(key),type);
+        }
+    }
+    for(const MimeTable::Entry& entry:BUILTIN_MIME_TYPES){
+        bool overridden=false;
+        for(const auto& custom:merged){
+            overridden=overridden||strcasecmp(custom.first.c_str(),std::string(entry.Suffix).c_str())==0;
+        }
+        if(!overridden){
+            merged.emplace_back(entry.Suffix,entry.Type());
+        }
+    }
+    //表项引用这里的字符串，先全部生成再取视图，之后不再修改
+    std::vector<std::string> strings;
+    strings.reserve(merged.size()*2);
+    for(const auto& [suffix,type]:merged){
+        strings.push_back(suffix);
+        strings.push_back(std::string(MimeTable::HEADER_PREFIX)+type+"\r\n");
+    }
+    std::vector<MimeTable::Entry> entries;
+    for(size_t i=0;i<strings.size();i+=2){
+        entries.push_back(MimeTable::Entry{strings[i],strings[i+1]});
+    }
+    //与内置表相同的生成过程，在启动时运行一次
+    auto table=std::make_unique<MimeTable>(entries.data(),entries.size());
+    if(!table->Valid()){
+        //后缀已去重，生成失败只可能是项数超出容量
+        throw std::invalid_argument("mime_types: more than "+std::to_string(MimeTable::MAX_ENTRIES)+
+                                    " suffixes ("+std::to_string(entries.size())+" after merging)");
+    }
+    CUSTOM_MIME_=std::move(table);
+    MIME_STRINGS_=std::move(strings);
+    MIME_=CUSTOM_MIME_.get();
+    return MIME_->Size();
+}
 HttpResponse::HttpResponse(){
     code_=-1;
     path_=srcDir_="";
     Are_You_Keep_Alive_=false;
-    mmFile_=nullptr;
-    mmFileStat_={0};
 };
 HttpResponse::~HttpResponse(){
     unmap_File();
 }
 
-void HttpResponse::Init(const std::string& srcDir,std::string& path,bool Are_You_Keep_Alive,int code){
+void HttpResponse::Init(const std::string& srcDir,std::string_view path,bool Are_You_Keep_Alive,int code,
+                        const Conditions& conditions){
     assert(srcDir!="");
-    if(mmFile_){
-        //如果mmFile_已经被映射，调用unmap_File来释放资源
-        unmap_File();
-    }code_=code;
+    //释放上一个响应的文件
+    unmap_File();
+    code_=code;
     Are_You_Keep_Alive_=Are_You_Keep_Alive;
     path_=path;
     srcDir_=srcDir;
-    //将mmFile_设置为nullptr，表示当前没有文件被映射
-    mmFile_=nullptr;
-    mmFileStat_={0};
+    conditions_=conditions;
+    extents_.clear();
+    content_range_.clear();
+    boundary_.clear();
 }
-void HttpResponse::make_Response(Buffer& buffer){
-    if(stat((srcDir_+path_).data(),&mmFileStat_)<0||S_ISDIR(mmFileStat_.st_mode)){
-        //检查文件状态，如果文件不存在或是一个目录，则设置状态码为404;S_ISDIR(mmFileStat_.st_mode)宏，用于检查文件是否是一个目录
+const std::string* HttpResponse::make_Response(Buffer& buffer){
+    //从缓存中取得文件，热点文件不需要stat/open/mmap
+    file_=FileCache::Instance().Get(srcDir_,path_);
+    if(!file_||S_ISDIR(file_->Stat.st_mode)){
+        //检查文件状态，如果文件不存在或是一个目录，则设置状态码为404;S_ISDIR宏，用于检查文件是否是一个目录
         code_=404;
-    }else if(!(mmFileStat_.st_mode & S_IROTH)){
-        //如果文件存在但不可读，则设置状态码为403,mmFileStat_.st_mode & S_IROTH检查文件是否对其他用户可读
+    }else if(!(file_->Stat.st_mode & S_IROTH)){
+        //如果文件存在但不可读，则设置状态码为403,st_mode & S_IROTH检查文件是否对其他用户可读
         code_=403;
     }else if(code_==-1){
         //如果代码中设置了特定的条件（code_==-1），则设置状态码为200
         code_=200;
     }
     errorHTML_();
-    add_State_Line_(buffer);
-    add_Response_Header_(buffer);
-    add_Response_Content_(buffer);
+    if(file_&&file_->Readable()&&STATUS.Find(code_)){
+        //有压缩版本且客户端接受时发送它（错误页面也一样），之后的验证器与区间都针对该版本
+        negotiate_Encoding_();
+    }
+    if(code_==200&&not_Modified_()){
+        //客户端的副本仍然有效：只发送响应头
+        code_=304;
+    }
+    if(!STATUS.Find(code_)){
+        //未知的状态码按400处理
+        code_=400;
+    }
+    if(!file_||!file_->Readable()||(file_->Stat.st_size>0&&!file_->Data)){
+        //文件不存在或无法映射
+        file_.reset();
+        error_Content(buffer,"File NotFound!");
+        return nullptr;
+    }
+    if(code_==200){
+        std::vector<std::pair<off_t,size_t>> ranges;
+        if(parse_Range_(ranges)){
+            //只发送请求的区间，响应头随区间变化，不缓存
+            range_Content_(buffer,ranges);
+            return nullptr;
+        }
+    }
+    //内存中的小文件：响应头之后紧接文件内容，整个响应一段连续内存
+    bool contiguous=code_!=304&&!file_->Content.empty()&&file_->Content.size()<=FileCache::Instance().Small_File_Max();
+    if(code_!=304&&!contiguous){
+        //整个文件（200或错误页面）
+        extents_.push_back(Extent{0,0,static_cast<size_t>(file_->Stat.st_size)});
+    }
+    //同一个文件、状态码与是否保持连接的响应头总是相同，第一次生成后保存在缓存项中
+    size_t slot=header_Slot_();
+    const std::string* header=file_->Header(slot);
+    if(!header){
+        std::string response=render_Header_(file_->Stat.st_size);
+        if(contiguous){
+            response+=file_->Content;
+        }
+        header=file_->Store_Header(slot,std::move(response));
+    }
+    return header;
 }
 char* HttpResponse::file(){
-    return mmFile_;
+    return file_?file_->Data:nullptr;
 }
 size_t HttpResponse::file_Length() const {
-    return mmFileStat_.st_size;
+    if(code_==304){
+        return 0;
+    }
+    return file_?file_->Stat.st_size:0;
+}
+int HttpResponse::file_Fd() const {
+    return file_?file_->Fd:-1;
 }
 void HttpResponse::errorHTML_(){
-    if(CODE_PATH.count(code_)==1){
-        //检查CODE_PATH映射中是否包含当前的状态码code_ 设置path_为对应的状态码的错误HTML文件路径
-        path_=CODE_PATH.find(code_)->second;
-        //调用stat系统函数来获取错误HTML文件的状态信息
-        stat((srcDir_ + path_).data(), &mmFileStat_);
-    }
-}
-void HttpResponse::add_State_Line_(Buffer& buffer){
-    std::string status;
-    if(CODE_STATUS.count(code_)==1){
-        //检查CODE_STATUS映射中是否包含code_键,如果存在，将对应的状态描述赋值给status
-        status=CODE_STATUS.find(code_)->second;
-    }else{
-        code_=400;
-        //获取状态码400对应的状态描述
-        status=CODE_STATUS.find(400)->second;
+    const StatusTable::Entry* status=STATUS.Find(code_);
+    if(status&&!status->Error_Page.empty()){
+        //当前状态码有错误页面时，设置path_为对应的错误HTML文件路径
+        path_=status->Error_Page;
+        //从缓存中取得错误HTML文件
+        file_=FileCache::Instance().Get(srcDir_,path_);
+    }
+}
+size_t HttpResponse::header_Slot_() const{
+    size_t index;
+    switch(code_){
+        case 200: index=0; break;
+        case 304: index=1; break;
+        case 400: index=2; break;
+        case 403: index=3; break;
+        default: index=4; break;
     }
-    buffer.Write_to_Buffer("HTTP/1.1"+std::to_string(code_)+" "+status+"\r\n");
+    return index*2+(Are_You_Keep_Alive_?1:0);
 }
-void HttpResponse::add_Response_Header_(Buffer& buffer){
-    buffer.Write_to_Buffer("Connection:");
+std::string HttpResponse::render_Header_(size_t Content_Length){
+    std::string header;
+    header.reserve(160);
+    //状态行
+    const StatusTable::Entry* status=STATUS.Find(code_);
+    header+=(status?status:STATUS.Find(400))->Line;
+    //响应头
     if(Are_You_Keep_Alive_){
-        buffer.Write_to_Buffer("keep-alive\r\n");
-        buffer.Write_to_Buffer("keep-alive: max=6,timeout=120\r\n");
+        header+="Connection: keep-alive\r\n";
+        header+="Keep-Alive: max=6, timeout=120\r\n";
     }else{
-        buffer.Write_to_Buffer("close\r\n");
+        header+="Connection: close\r\n";
+    }
+    //预先生成的Content-Type响应头行
+    const MimeTable::Entry& mime=mime_Entry_();
+    if(boundary_.empty()){
+        header+=mime.Header;
+    }else{
+        header+="Content-Type: multipart/byteranges; boundary=";
+        header+=boundary_;
+        header+="\r\n";
+    }
+    if(!content_range_.empty()){
+        header+="Content-Range: ";
+        header+=content_range_;
+        header+="\r\n";
+    }
+    if(file_&&!file_->Encoding.empty()){
+        //发送的是压缩版本（包括错误页面）
+        header+="Content-Encoding: ";
+        header+=file_->Encoding;
+        header+="\r\n";
     }
-    buffer.Write_to_Buffer("Content-type:"+get_File_Type()+"\r\n");
+    if(file_&&varies_()){
+        //同一路径的响应随Accept-Encoding变化
+        header+="Vary: Accept-Encoding\r\n";
+    }
+    if((code_==200||code_==206||code_==304)&&file_&&!file_->ETag.empty()){
+        header+="Accept-Ranges: bytes\r\n";
+        //验证器与缓存策略
+        header+="ETag: ";
+        header+=file_->ETag;
+        header+="\r\nLast-Modified: ";
+        header+=file_->Last_Modified;
+        header+="\r\n";
+        auto max_age=MAX_AGE.find(std::string(mime.Type()));
+        if(max_age==MAX_AGE.end()){
+            max_age=MAX_AGE.find("*");
+        }
+        if(max_age!=MAX_AGE.end()){
+            header+="Cache-Control: max-age=";
+            header+=std::to_string(max_age->second);
+            header+="\r\n";
+        }
+    }
+    if(code_!=304){
+        //304没有正文
+        header+="Content-Length: ";
+        header+=std::to_string(Content_Length);
+        header+="\r\n";
+    }
+    header+="\r\n";
+    return header;
 }
-void HttpResponse::add_Response_Content_(Buffer& buffer){
-    int srcFD=open((srcDir_+path_).data(),O_RDONLY);
-    if(srcFD<0){
-        error_Content(buffer,"File NotFound!");
+bool HttpResponse::accepts_Encoding_(std::string_view Coding) const{
+    std::string_view list(conditions_.Accept_Encoding);
+    //没有明确列出时按"*"的q值
+    int matched=-1,wildcard=-1;
+    while(!list.empty()){
+        size_t comma=list.find(',');
+        std::string_view item=list.substr(0,comma);
+        list=comma==std::string_view::npos?std::string_view():list.substr(comma+1);
+        //内容编码与可选的q值，如 "gzip;q=0.5"
+        size_t semicolon=item.find(';');
+        std::string_view name=item.substr(0,semicolon);
+        while(!name.empty()&&(name.front()==' '||name.front()=='\t')){
+            name.remove_prefix(1);
+        }
+        while(!name.empty()&&(name.back()==' '||name.back()=='\t')){
+            name.remove_suffix(1);
+        }
+        bool accepted=true;
+        if(semicolon!=std::string_view::npos){
+            std::string_view params=item.substr(semicolon+1);
+            size_t q=params.find("q=");
+            if(q!=std::string_view::npos){
+                //q=0、q=0.0、q=0.00、q=0.000表示不接受
+                std::string_view value=params.substr(q+2);
+                accepted=!value.empty()&&value[0]!='0';
+                for(size_t i=1;!accepted&&i<value.size()&&i<5;++i){
+                    if(value[i]>='1'&&value[i]<='9'){
+                        accepted=true;
+                    }else if(value[i]!='0'&&value[i]!='.'){
+                        break;
+                    }
+                }
+            }
+        }
+        if(name.size()==Coding.size()&&strncasecmp(name.data(),Coding.data(),Coding.size())==0){
+            matched=accepted;
+        }else if(name=="*"){
+            wildcard=accepted;
+        }
+    }
+    return matched>=0?matched==1:wildcard==1;
+}
+bool HttpResponse::compressible_Type_(std::string_view Type){
+    return Type.substr(0,5)=="text/"||Type.find("xml")!=std::string_view::npos||
+           Type.find("json")!=std::string_view::npos||Type.find("javascript")!=std::string_view::npos||
+           Type=="application/rtf";
+}
+bool HttpResponse::varies_(){
+    return !file_->Encoding.empty()||file_->Has_Encodings()||
+           (GzipCache::Instance().Enabled(file_->Stat.st_size)&&compressible_Type_(get_File_Type()));
+}
+void HttpResponse::negotiate_Encoding_(){
+    if(conditions_.Accept_Encoding.empty()){
         return;
     }
-    // 将文件映射到内存提高文件的访问速度 
-    // MAP_PRIVATE 建立一个写入时拷贝的私有映射
-    int* mmRet=(int*)mmap(0,mmFileStat_.st_size,PROT_READ,MAP_PRIVATE,srcFD,0);
-    if(*mmRet==-1){
-        error_Content(buffer,"File NotFound");
+    //预压缩版本优先，brotli压缩率更高
+    if(file_->Brotli&&accepts_Encoding_("br")){
+        file_=file_->Brotli;
         return;
     }
-    mmFile_=(char*)mmRet;
-    close(srcFD);
-    buffer.Write_to_Buffer("Content-Length:"+std::to_string(mmFileStat_.st_size)+"\r\n\r\n"); 
+    bool gzip=accepts_Encoding_("gzip")||accepts_Encoding_("x-gzip");
+    if(!gzip){
+        return;
+    }
+    if(file_->Gzip){
+        file_=file_->Gzip;
+    }else if(GzipCache::Instance().Enabled(file_->Stat.st_size)&&compressible_Type_(get_File_Type())){
+        //动态压缩：命中时发送缓存的结果，否则本次发送原文件
+        auto compressed=GzipCache::Instance().Get(path_,file_);
+        if(compressed){
+            file_=compressed;
+        }
+    }
 }
-void HttpResponse::unmap_File(){
-    if(mmFile_){
-        munmap(mmFile_,mmFileStat_.st_size);
-        mmFile_=nullptr;
+bool HttpResponse::parse_Range_(std::vector<std::pair<off_t,size_t>>& Ranges) const{
+    const size_t size=file_->Stat.st_size;
+    std::string_view spec(conditions_.Range);
+    if(spec.substr(0,6)!="bytes="||size==0||file_->ETag.empty()){
+        //没有Range、不是字节区间或空文件：发送整个文件
+        return false;
+    }
+    if(!conditions_.If_Range.empty()&&conditions_.If_Range!=file_->ETag&&conditions_.If_Range!=file_->Last_Modified){
+        //If-Range不匹配：文件已经变化，发送整个文件
+        return false;
+    }
+    spec.remove_prefix(6);
+    //解析非负整数，没有数字时返回false
+    auto number=[](std::string_view& Text,size_t& Value){
+        size_t i=0;
+        Value=0;
+        while(i<Text.size()&&Text[i]>='0'&&Text[i]<='9'){
+            if(Value>(SIZE_MAX-9)/10){
+                return false;
+            }
+            Value=Value*10+(Text[i]-'0');
+            ++i;
+        }
+        Text.remove_prefix(i);
+        return i>0;
+    };
+    size_t count=0;
+    while(!spec.empty()){
+        size_t comma=spec.find(',');
+        std::string_view item=spec.substr(0,comma);
+        spec=comma==std::string_view::npos?std::string_view():spec.substr(comma+1);
+        while(!item.empty()&&(item.front()==' '||item.front()=='\t')){
+            item.remove_prefix(1);
+        }
+        while(!item.empty()&&(item.back()==' '||item.back()=='\t')){
+            item.remove_suffix(1);
+        }
+        if(item.empty()){
+            continue;
+        }
+        if(++count>MAX_RANGES_){
+            //区间过多：忽略Range
+            Ranges.clear();
+            return false;
+        }
+        size_t first=0,last=0;
+        if(item.front()=='-'){
+            //后缀区间：最后last个字节
+            item.remove_prefix(1);
+            if(!number(item,last)||!item.empty()){
+                Ranges.clear();
+                return false;
+            }
+            if(last==0){
+                continue;
+            }
+            first=last>=size?0:size-last;
+            last=size-1;
+        }else{
+            if(!number(item,first)||item.empty()||item.front()!='-'){
+                Ranges.clear();
+                return false;
+            }
+            item.remove_prefix(1);
+            if(item.empty()){
+                last=size-1;
+            }else if(!number(item,last)||!item.empty()||last<first){
+                Ranges.clear();
+                return false;
+            }
+            if(first>=size){
+                //起点超出文件：该区间不可满足
+                continue;
+            }
+            if(last>=size){
+                last=size-1;
+            }
+        }
+        Ranges.emplace_back(static_cast<off_t>(first),last-first+1);
+    }
+    return true;
+}
+void HttpResponse::range_Content_(Buffer& buffer,const std::vector<std::pair<off_t,size_t>>& Ranges){
+    const size_t size=file_->Stat.st_size;
+    if(Ranges.empty()){
+        //没有可满足的区间
+        code_=416;
+        content_range_="bytes */"+std::to_string(size);
+        buffer.Write_to_Buffer(render_Header_(0));
+        return;
+    }
+    code_=206;
+    if(Ranges.size()==1){
+        content_range_="bytes "+std::to_string(Ranges[0].first)+"-"+
+                       std::to_string(Ranges[0].first+Ranges[0].second-1)+"/"+std::to_string(size);
+        std::string header=render_Header_(Ranges[0].second);
+        buffer.Write_to_Buffer(header);
+        extents_.push_back(Extent{header.size(),Ranges[0].first,Ranges[0].second});
+        return;
     }
+    //多个区间：multipart/byteranges，每段之前是分段头，最后是结束分隔符
+    char boundary[32];
+    snprintf(boundary,sizeof(boundary),"%016zx",std::hash<std::string>()(file_->ETag));
+    boundary_=boundary;
+    std::string_view type_header=mime_Entry_().Header;
+    std::vector<std::string> parts;
+    size_t length=0;
+    for(const auto& range:Ranges){
+        parts.push_back("\r\n--"+boundary_+"\r\n"+std::string(type_header)+"Content-Range: bytes "+
+                        std::to_string(range.first)+"-"+std::to_string(range.first+range.second-1)+"/"+
+                        std::to_string(size)+"\r\n\r\n");
+        length+=parts.back().size()+range.second;
+    }
+    std::string trailer="\r\n--"+boundary_+"--\r\n";
+    length+=trailer.size();
+    std::string header=render_Header_(length);
+    buffer.Write_to_Buffer(header);
+    for(size_t i=0;i<Ranges.size();++i){
+        buffer.Write_to_Buffer(parts[i]);
+        extents_.push_back(Extent{(i==0?header.size():0)+parts[i].size(),Ranges[i].first,Ranges[i].second});
+    }
+    buffer.Write_to_Buffer(trailer);
 }
-std::string HttpResponse::get_File_Type(){
-    std::string::size_type idx=path_.find_last_of('.');
-    if(idx==std::string::npos){
-        //返回默认的MIME类型"text/plain"
-        return "text/plain";
+bool HttpResponse::not_Modified_() const{
+    if(!file_||file_->ETag.empty()){
+        return false;
     }
-    //从’.'的位置开始提取子字符串作为文件扩展名
-    std::string suffix=path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix)==1){
-        //检查SUFFIX_TYPE映射（可能是一个std::map）中是否包含该扩展名。如果包含，则返回对应的MIME类型
-        return SUFFIX_TYPE.find(suffix)->second;
+    if(!conditions_.If_None_Match.empty()){
+        //If-None-Match优先：逐个比较实体标签（弱比较，忽略W/前缀），"*"匹配任何存在的文件
+        std::string_view list(conditions_.If_None_Match);
+        while(!list.empty()){
+            size_t comma=list.find(',');
+            std::string_view tag=list.substr(0,comma);
+            list=comma==std::string_view::npos?std::string_view():list.substr(comma+1);
+            while(!tag.empty()&&(tag.front()==' '||tag.front()=='\t')){
+                tag.remove_prefix(1);
+            }
+            while(!tag.empty()&&(tag.back()==' '||tag.back()=='\t')){
+                tag.remove_suffix(1);
+            }
+            if(tag.substr(0,2)=="W/"){
+                tag.remove_prefix(2);
+            }
+            if(tag=="*"||tag==file_->ETag){
+                return true;
+            }
+        }
+        return false;
     }
-    return "text/plain";
+    if(!conditions_.If_Modified_Since.empty()){
+        //HTTP日期只精确到秒；视图不以'\0'结尾，复制到栈上再解析（合法的日期为29个字符）
+        char text[64];
+        if(conditions_.If_Modified_Since.size()>=sizeof(text)){
+            return false;
+        }
+        conditions_.If_Modified_Since.copy(text,conditions_.If_Modified_Since.size());
+        text[conditions_.If_Modified_Since.size()]='\0';
+        tm date={};
+        const char* end=strptime(text,"%a, %d %b %Y %H:%M:%S GMT",&date);
+        if(!end){
+            return false;
+        }
+        return file_->Stat.st_mtim.tv_sec<=timegm(&date);
+    }
+    return false;
+}
+void HttpResponse::unmap_File(){
+    //映射由FileCache管理，最后一个引用释放时才解除
+    file_.reset();
+}
+const MimeTable::Entry& HttpResponse::mime_Entry_() const{
+    std::string_view path(path_);
+    //从末尾找最后一个路径段中的'.'
+    size_t idx=path.size();
+    while(idx>0&&path[idx-1]!='.'&&path[idx-1]!='/'){
+        --idx;
+    }
+    if(idx==0||path[idx-1]!='.'){
+        //没有后缀时为默认的MIME类型"text/plain"
+        return DEFAULT_MIME;
+    }
+    //从'.'开始的扩展名，在完美哈希表中查找，不分配内存
+    const MimeTable::Entry* entry=MIME_->Find(path.substr(idx-1));
+    return entry?*entry:DEFAULT_MIME;
+}
+std::string_view HttpResponse::get_File_Type() const{
+    return mime_Entry_().Type();
 }
 void HttpResponse::error_Content(Buffer& buffer, std::string message) {
     std::string body;
-    std::string status;
     body+="<html><title>Error</title>";
     body+="<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_)==1){
-        //检查CODE_STATUS映射中是否包含当前的状态码code_，如果包含，则获取对应的状态消息；如果不包含，则默认为"Bad Request"
-        status= CODE_STATUS.find(code_)->second;
-    }else{
-        status="Bad Request";
-    }
-    body+=std::to_string(code_)+":"+status+"\n";
+    //当前状态码的原因短语，不在表中时为"Bad Request"
+    const StatusTable::Entry* status=STATUS.Find(code_);
+    body+=std::to_string(code_)+":"+std::string(status?status->Reason:"Bad Request")+"\n";
     body+="<p>"+message+"</p>";
     body+="<hr><em>TinyWebServer</em></body></html>";
-    buffer.Write_to_Buffer("Content-Length:"+ std::to_string(body.size()) + "\r\n\r\n");
+    buffer.Write_to_Buffer(render_Header_(body.size()));
     buffer.Write_to_Buffer(body);
 }
\ No newline at end of file
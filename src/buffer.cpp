@@ -1,40 +1,77 @@
 #include "buffer.h"
 
-//初始化Buffer，initBuffersize是初始大小，给读、写索引赋初值为０
-Buffer::Buffer(int initBuffersize):buffer_(initBuffersize),ReadPos_(0),WritePos_(0){};
+//初始化Buffer，initBuffersize是初始大小(为0时不分配)，给读、写索引赋初值为０
+Buffer::Buffer(int initBuffersize):Data_(nullptr),Capacity_(0),ReadPos_(0),WritePos_(0){
+    if(initBuffersize>0){
+        Capacity_=initBuffersize;
+        Data_=BufferPool::Allocate(Capacity_);
+    }
+    Take_Ownership();
+};
+Buffer::~Buffer(){
+    BufferPool::Deallocate(Data_,Capacity_);
+}
 char* Buffer::BeginPtr_(){
-    //解引用迭代器再返回指针，迭代器更抽象，指针更底层
-    return &*buffer_.begin();
+    return Data_;
 }
 
 
 const char* Buffer::BeginPtr_() const {
     //只读
-    return &*buffer_.begin();
+    return Data_;
 }
 
 void Buffer::Init_Buffer(){
-    //使用memset将buffer_置０
-    std::memset(BeginPtr_(), 0, buffer_.size());
+    Check_Owner_();
+    //只重置读写位置：可读区间之外的内容不会被读到，无需清零
+    ReadPos_=0;
+    WritePos_=0;
+}
+bool Buffer::Release(){
+    Check_Owner_();
+    if(How_Many_Bytes_We_Need_Read()>0){
+        return false;
+    }
+    BufferPool::Deallocate(Data_,Capacity_);
+    Data_=nullptr;
+    Capacity_=0;
     ReadPos_=0;
     WritePos_=0;
+    return true;
+}
+void Buffer::Swap(Buffer& Other){
+    Check_Owner_();
+    Other.Check_Owner_();
+    std::swap(Data_,Other.Data_);
+    std::swap(Capacity_,Other.Capacity_);
+    std::swap(ReadPos_,Other.ReadPos_);
+    std::swap(WritePos_,Other.WritePos_);
 }
 void Buffer::We_Should_Be_Enough_(size_t Length_We_Need){
+    size_t T_Not_Read=How_Many_Bytes_We_Need_Read();
     if(ReadPos_ + How_Many_Bytes_Can_We_Write()<Length_We_Need){
-        //空间不足所有可以覆盖的空间(写过的-读过的＋还可以写的)小于Length_We_Need
-        buffer_.resize(WritePos_+Length_We_Need+1);
+        //空间不足所有可以覆盖的空间(写过的-读过的＋还可以写的)小于Length_We_Need：
+        //换一个更大级别的块（按级别向上取整，容量成倍增长），只拷贝待读的部分；没有借用存储时直接借用
+        size_t capacity=T_Not_Read+Length_We_Need;
+        if(capacity<Capacity_*2){
+            capacity=Capacity_*2;
+        }
+        char* data=BufferPool::Allocate(capacity);
+        std::copy(BeginPtr_()+ReadPos_,BeginPtr_()+WritePos_,data);
+        BufferPool::Deallocate(Data_,Capacity_);
+        Data_=data;
+        Capacity_=capacity;
     }else{
         //T_ReadPos表示待读的,将待读的移到首段，ReadPos_=0，WritePos_=T_Not_Read;
-        size_t T_Not_Read=How_Many_Bytes_We_Need_Read();
         //copy函数(待拷贝首，待拷贝尾，目标拷贝地址)
         std::copy(BeginPtr_()+ReadPos_,BeginPtr_()+WritePos_,BeginPtr_());
-        WritePos_=T_Not_Read;
-        ReadPos_=0;
     }
+    WritePos_=T_Not_Read;
+    ReadPos_=0;
 }
 
 size_t Buffer::How_Many_Bytes_Can_We_Write() const {
-    return buffer_.size()-WritePos_;
+    return Capacity_-WritePos_;
 }
 
 size_t Buffer::How_Many_Bytes_We_Need_Read() const {
@@ -42,13 +79,14 @@ size_t Buffer::How_Many_Bytes_We_Need_Read() const {
 }
 
 const char* Buffer::Where_Did_We_Read() const{
-    return &*buffer_.begin()+ReadPos_;
+    return Data_+ReadPos_;
 }
 
 void Buffer::Update_ReadPos(size_t Step_Lenght){
     //需要首先确认更新位置有效(前进距离小于等于带读取的长度)
     assert(Step_Lenght<=How_Many_Bytes_We_Need_Read());
-    ReadPos_=ReadPos_+Step_Lenght;
+    Check_Owner_();
+    ReadPos_+=Step_Lenght;
 }
 
 void Buffer::Update_ReadPos(const char* Destination){
@@ -72,9 +110,10 @@ void Buffer::Do_We_Have_Enough_Spase(size_t Length_We_Need){
 
 void Buffer::Write_to_Buffer(const char* Data,size_t Data_Length){
     assert(Data);//确认非空
+    Check_Owner_();
     Do_We_Have_Enough_Spase(Data_Length);
     std::copy(Data,Data+Data_Length,Where_Did_We_Write());
-    WritePos_=WritePos_+Data_Length;//更新写指针
+    WritePos_+=Data_Length;//更新写指针
 }
 
 void Buffer::Write_to_Buffer(const std::string& Data){
@@ -91,7 +130,8 @@ void Buffer::Write_to_Buffer(const Buffer& Data_of_Other_Buffer){
 }
 
 ssize_t Buffer::Get_Data(int FileD,int* Errono){
-    //Buffer_Temple临时存储超界数据
+    Check_Owner_();
+    //Buffer_Temple临时存储超界数据；没有借用存储时数据全部先读到这里，读到数据后才借用存储块
     char Buffer_Temple[8192];
     //iovec是标明可以写入或读取的内存区的结构体，需要给出起点和长度，配合函数readv以及writev
     iovec  Ready_for_Input[2];
@@ -106,21 +146,22 @@ ssize_t Buffer::Get_Data(int FileD,int* Errono){
         *Errono=errno;
         return Length_We_Get_From_File;
     }else if(static_cast<size_t>(Length_We_Get_From_File)<=Write_Space_We_Can_Use){
-        WritePos_=WritePos_+Length_We_Get_From_File;
+        WritePos_+=Length_We_Get_From_File;
     }else{
-        WritePos_=buffer_.size();
+        WritePos_=Capacity_;
         Write_to_Buffer(Buffer_Temple,Length_We_Get_From_File-Write_Space_We_Can_Use);
     }return Length_We_Get_From_File;
 }
 
 ssize_t Buffer::Put_Data(int FileD,int *Errno){
+    Check_Owner_();
     const size_t Read_Space_We_Can_Use=How_Many_Bytes_We_Need_Read();
     ssize_t Length_We_Write_to_File=write(FileD,Where_Did_We_Read(),Read_Space_We_Can_Use);
     if(Length_We_Write_to_File<0){
         *Errno=errno;
         return Length_We_Write_to_File;
     }
-    ReadPos_=ReadPos_+Length_We_Write_to_File;
+    ReadPos_+=Length_We_Write_to_File;
     return Length_We_Write_to_File;
 }
 
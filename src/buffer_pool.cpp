@@ -0,0 +1,87 @@
+#include"buffer_pool.h"
+
+//线程退出、池析构后仍可能有块归还（如thread_local析构顺序靠后的对象），此时直接释放
+static thread_local bool Pool_Destroyed_=false;
+
+BufferPool::BufferPool():Hits_(0),Misses_(0){
+    for(auto& level:Classes_){
+        level.Count=0;
+    }
+}
+BufferPool::~BufferPool(){
+    for(auto& level:Classes_){
+        for(size_t i=0;i<level.Count;++i){
+            free(level.Free[i]);
+        }
+        level.Count=0;
+    }
+    Pool_Destroyed_=true;
+}
+BufferPool* BufferPool::Local_(){
+    if(Pool_Destroyed_){
+        return nullptr;
+    }
+    static thread_local BufferPool pool;
+    return &pool;
+}
+size_t BufferPool::Class_Of_(size_t Size){
+    size_t index=0;
+    while(index<CLASS_COUNT_&&Size>Class_Size_(index)){
+        ++index;
+    }
+    return index;
+}
+size_t BufferPool::Round_Up(size_t Size){
+    size_t index=Class_Of_(Size);
+    return index<CLASS_COUNT_?Class_Size_(index):Size;
+}
+char* BufferPool::Allocate(size_t& Capacity){
+    size_t index=Class_Of_(Capacity);
+    BufferPool* pool=Local_();
+    if(index<CLASS_COUNT_){
+        Capacity=Class_Size_(index);
+        if(pool&&pool->Classes_[index].Count>0){
+            Class_& level=pool->Classes_[index];
+            ++pool->Hits_;
+            return level.Free[--level.Count];
+        }
+    }
+    if(pool){
+        ++pool->Misses_;
+    }
+    char* data=static_cast<char*>(malloc(Capacity));
+    if(!data){
+        throw std::bad_alloc();
+    }
+    return data;
+}
+void BufferPool::Deallocate(char* Data,size_t Capacity){
+    if(!Data){
+        return;
+    }
+    size_t index=Class_Of_(Capacity);
+    BufferPool* pool=Local_();
+    if(pool&&index<CLASS_COUNT_&&Capacity==Class_Size_(index)){
+        Class_& level=pool->Classes_[index];
+        //该级别缓存的字节数未超过上限时留在池中
+        if((level.Count+1)*Capacity<=MAX_CACHED_BYTES_){
+            level.Free[level.Count++]=Data;
+            return;
+        }
+    }
+    free(Data);
+}
+BufferPool::Stats BufferPool::Local_Stats(){
+    Stats stats={0,0,0,0};
+    BufferPool* pool=Local_();
+    if(!pool){
+        return stats;
+    }
+    for(size_t i=0;i<CLASS_COUNT_;++i){
+        stats.Cached_Blocks+=pool->Classes_[i].Count;
+        stats.Cached_Bytes+=pool->Classes_[i].Count*Class_Size_(i);
+    }
+    stats.Hits=pool->Hits_;
+    stats.Misses=pool->Misses_;
+    return stats;
+}
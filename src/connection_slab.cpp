@@ -0,0 +1,30 @@
+#include"connection_slab.h"
+
+ConnectionSlab::ConnectionSlab(size_t Capacity):Slots_(nullptr),Capacity_(0){
+    //匿名映射按页清零且按需提交物理内存，未使用的描述符不占内存
+    void* slots=mmap(nullptr,Capacity*sizeof(Slot_),PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0);
+    if(slots==MAP_FAILED){
+        std::cerr<<"connection slab allocation failed"<<std::endl;
+        return;
+    }
+    Slots_=static_cast<Slot_*>(slots);
+    Capacity_=Capacity;
+}
+ConnectionSlab::~ConnectionSlab(){
+    if(!Slots_){
+        return;
+    }
+    for(size_t i=0;i<Capacity_;++i){
+        if(Slots_[i].Constructed){
+            connection_(Slots_[i])->~HttpConnection();
+        }
+    }
+    munmap(Slots_,Capacity_*sizeof(Slot_));
+}
+size_t ConnectionSlab::Default_Capacity(size_t Max){
+    rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE,&limit)==0&&limit.rlim_cur!=RLIM_INFINITY&&limit.rlim_cur<Max){
+        return limit.rlim_cur;
+    }
+    return Max;
+}
@@ -0,0 +1,490 @@
+#include"file_cache.h"
+#include<sys/inotify.h>
+#include<sys/eventfd.h>
+#include<poll.h>
+#include<filesystem>
+#include<iostream>
+#include<cinttypes>
+#include<ctime>
+#include<vector>
+
+FileCache::File::File():Fd(-1),Stat{},Data(nullptr),Last_Used(0),Header_Bytes(0),Budget(nullptr),Budget_Bytes(0),
+Dynamic_Gzip_Used(false),Incompressible(false){
+    for(auto& header:Headers){
+        header.store(nullptr,std::memory_order_relaxed);
+    }
+}
+FileCache::File::~File(){
+    if(Budget){
+        //退还计入内存预算的字节数
+        Budget->fetch_sub(Budget_Bytes.load(std::memory_order_relaxed),std::memory_order_relaxed);
+    }
+    for(auto& header:Headers){
+        delete header.load(std::memory_order_relaxed);
+    }
+    if(Data&&Content.empty()){
+        munmap(Data,Stat.st_size);
+    }
+    if(Fd>=0){
+        close(Fd);
+    }
+}
+const std::string* FileCache::File::Store_Header(size_t Slot,std::string Header) const{
+    assert(Slot<HEADER_SLOTS);
+    const std::string* rendered=new std::string(std::move(Header));
+    const std::string* expected=nullptr;
+    if(!Headers[Slot].compare_exchange_strong(expected,rendered,std::memory_order_acq_rel)){
+        //另一个线程已经安装
+        delete rendered;
+        return expected;
+    }
+    Header_Bytes.fetch_add(rendered->size(),std::memory_order_relaxed);
+    if(Budget){
+        Budget_Bytes.fetch_add(rendered->size(),std::memory_order_relaxed);
+        Budget->fetch_add(rendered->size(),std::memory_order_relaxed);
+    }
+    return rendered;
+}
+size_t FileCache::File::Memory_Bytes() const{
+    size_t bytes=Content.size()+Header_Bytes.load(std::memory_order_relaxed);
+    if(Brotli){
+        bytes+=Brotli->Memory_Bytes();
+    }
+    if(Gzip){
+        bytes+=Gzip->Memory_Bytes();
+    }
+    return bytes;
+}
+
+FileCache::FileCache():Ttl_(0),Precompressed_(false),Small_Max_(0),Small_Budget_(0),Memory_Bytes_(0),Generation_(0),
+InotifyFd_(-1),StopFd_(-1){
+}
+FileCache::~FileCache(){
+    if(Watcher_.joinable()){
+        //通知监视线程退出
+        uint64_t one=1;
+        ssize_t ret=write(StopFd_,&one,sizeof(one));
+        (void)ret;
+        Watcher_.join();
+    }
+    if(InotifyFd_>=0){
+        close(InotifyFd_);
+    }
+    if(StopFd_>=0){
+        close(StopFd_);
+    }
+}
+FileCache& FileCache::Instance(){
+    static FileCache cache;
+    return cache;
+}
+void FileCache::Init(const std::string& Root,int TtlMs,bool Precompressed,size_t Small_Max,size_t Small_Budget){
+    assert(!Watcher_.joinable());
+    Root_=Root;
+    Precompressed_=Precompressed;
+    Small_Max_=Small_Budget>0?Small_Max:0;
+    Small_Budget_=Small_Budget;
+    while(Root_.size()>1&&Root_.back()=='/'){
+        Root_.pop_back();
+    }
+    Ttl_=std::chrono::milliseconds(TtlMs>0?TtlMs:0);
+    InotifyFd_=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    StopFd_=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    if(InotifyFd_<0||StopFd_<0){
+        if(Ttl_.count()==0){
+            //无法得知文件变化，只能依靠TTL
+            Ttl_=std::chrono::milliseconds(DEFAULT_TTL_MS_);
+        }
+        std::cerr<<"inotify unavailable, file cache entries expire after "<<Ttl_.count()<<" ms"<<std::endl;
+        return;
+    }
+    watch_tree_("");
+    Watcher_=std::thread(&FileCache::watch_loop_,this);
+}
+bool FileCache::is_canonical_(std::string_view Path){
+    if(Path.empty()||Path[0]!='/'){
+        return false;
+    }
+    //逐段检查，不允许空段、"."与".."
+    size_t Begin=1;
+    while(Begin<=Path.size()){
+        size_t End=Path.find('/',Begin);
+        if(End==std::string_view::npos){
+            End=Path.size();
+        }
+        std::string_view Segment=Path.substr(Begin,End-Begin);
+        if(Segment.empty()||Segment=="."||Segment==".."){
+            return false;
+        }
+        Begin=End+1;
+    }
+    return true;
+}
+bool FileCache::is_sibling_(std::string_view Path,std::string_view& Base){
+    for(std::string_view suffix:{std::string_view(".br"),std::string_view(".gz")}){
+        if(Path.size()>suffix.size()&&Path.substr(Path.size()-suffix.size())==suffix){
+            Base=Path.substr(0,Path.size()-suffix.size());
+            return true;
+        }
+    }
+    return false;
+}
+std::shared_ptr<const FileCache::File> FileCache::load_sibling_(const std::string& FullPath,const File& Original,
+                                                                const char* Encoding,size_t Small_Max){
+    auto file=load_(FullPath+(Encoding[0]=='b'?".br":".gz"),false,Small_Max);
+    if(!file||!S_ISREG(file->Stat.st_mode)||!file->Readable()||file->Stat.st_size>=Original.Stat.st_size){
+        return nullptr;
+    }
+    //比原文件旧：原文件修改后还没有重新生成，不能使用
+    if(file->Stat.st_mtim.tv_sec<Original.Stat.st_mtim.tv_sec||
+       (file->Stat.st_mtim.tv_sec==Original.Stat.st_mtim.tv_sec&&file->Stat.st_mtim.tv_nsec<Original.Stat.st_mtim.tv_nsec)){
+        return nullptr;
+    }
+    //load_返回的是刚创建的对象，尚未共享
+    std::const_pointer_cast<File>(file)->Encoding=Encoding;
+    return file;
+}
+std::shared_ptr<const FileCache::File> FileCache::load_(const std::string& FullPath,bool Siblings,size_t Small_Max,
+                                                        bool Populate){
+    auto file=std::make_shared<File>();
+    if(stat(FullPath.data(),&file->Stat)<0){
+        return nullptr;
+    }
+    file->Loaded=std::chrono::steady_clock::now();
+    if(S_ISDIR(file->Stat.st_mode)||!(file->Stat.st_mode&S_IROTH)){
+        //目录与不可读文件只缓存状态信息，由调用方返回404/403
+        return file;
+    }
+    file->Fd=open(FullPath.data(),O_RDONLY|O_CLOEXEC);
+    if(file->Fd<0){
+        return nullptr;
+    }
+    if(S_ISREG(file->Stat.st_mode)&&file->Stat.st_size>0&&static_cast<size_t>(file->Stat.st_size)<=Small_Max){
+        //小文件：读入内存后关闭描述符，不建立映射
+        file->Content.resize(file->Stat.st_size);
+        size_t done=0;
+        while(done<file->Content.size()){
+            ssize_t got=pread(file->Fd,file->Content.data()+done,file->Content.size()-done,done);
+            if(got<=0){
+                if(got<0&&errno==EINTR){
+                    continue;
+                }
+                break;
+            }
+            done+=got;
+        }
+        close(file->Fd);
+        file->Fd=-1;
+        if(done!=file->Content.size()){
+            //读取期间文件被截断
+            return nullptr;
+        }
+        file->Data=file->Content.data();
+    }else if(file->Stat.st_size>0){
+        //MAP_PRIVATE 建立一个写入时拷贝的私有映射
+        void* data=mmap(nullptr,file->Stat.st_size,PROT_READ,MAP_PRIVATE|(Populate?MAP_POPULATE:0),file->Fd,0);
+        if(data==MAP_FAILED){
+            return nullptr;
+        }
+        file->Data=static_cast<char*>(data);
+    }
+    make_validators_(*file);
+    std::string_view Base;
+    if(Siblings&&S_ISREG(file->Stat.st_mode)&&file->Stat.st_size>0&&!is_sibling_(FullPath,Base)){
+        file->Brotli=load_sibling_(FullPath,*file,"br",Small_Max);
+        file->Gzip=load_sibling_(FullPath,*file,"gzip",Small_Max);
+    }
+    return file;
+}
+void FileCache::make_validators_(File& Loaded){
+    //inode、大小或修改时间任一变化都会得到不同的ETag
+    char text[64];
+    uint64_t mtime_ns=static_cast<uint64_t>(Loaded.Stat.st_mtim.tv_sec)*1000000000ull+Loaded.Stat.st_mtim.tv_nsec;
+    snprintf(text,sizeof(text),"\"%" PRIx64 "-%" PRIx64 "-%" PRIx64 "\"",static_cast<uint64_t>(Loaded.Stat.st_ino),
+             static_cast<uint64_t>(Loaded.Stat.st_size),mtime_ns);
+    Loaded.ETag=text;
+    tm gmt;
+    if(gmtime_r(&Loaded.Stat.st_mtim.tv_sec,&gmt)&&strftime(text,sizeof(text),"%a, %d %b %Y %H:%M:%S GMT",&gmt)>0){
+        Loaded.Last_Modified=text;
+    }
+}
+std::shared_ptr<const FileCache::File> FileCache::Get(const std::string& Dir,std::string_view Path){
+    std::string_view Base(Dir);
+    while(Base.size()>1&&Base.back()=='/'){
+        Base.remove_suffix(1);
+    }
+    if(!is_canonical_(Path)){
+        //路径不规范（含空段、"."或".."段）：".."可以访问资源目录以外的文件，一律按不存在处理
+        return nullptr;
+    }
+    if(Root_.empty()||Base!=Root_){
+        //不在资源目录下，不缓存
+        return load_(std::string(Base).append(Path),Precompressed_);
+    }
+    uint64_t now=now_coarse_();
+    uint64_t Generation;
+    {
+        std::shared_lock<std::shared_mutex> lock(Mutex_);
+        Generation=Generation_;
+        auto it=Files_.find(Path);
+        if(it!=Files_.end()&&(Ttl_.count()==0||std::chrono::steady_clock::now()-it->second->Loaded<Ttl_)){
+            //时钟变化时才写入，热点文件不会在多个线程间反复写同一缓存行
+            if(it->second->Last_Used.load(std::memory_order_relaxed)!=now){
+                it->second->Last_Used.store(now,std::memory_order_relaxed);
+            }
+            return it->second;
+        }
+    }
+    //未命中或已过期：在锁外加载，避免阻塞其它线程的查找
+    auto file=load_(Root_+std::string(Path),Precompressed_,Small_Max_);
+    if(file){
+        file->Last_Used.store(now,std::memory_order_relaxed);
+    }
+    std::unique_lock<std::shared_mutex> lock(Mutex_);
+    if(!file){
+        Files_.erase(std::string(Path));
+        return nullptr;
+    }
+    if(Generation!=Generation_){
+        //加载期间文件可能发生了变化，本次结果只给当前请求使用
+        return file;
+    }
+    auto it=Files_.find(Path);
+    if(it!=Files_.end()){
+        it->second=file;
+    }else if(Files_.size()<MAX_ENTRIES_){
+        it=Files_.emplace(std::string(Path),file).first;
+    }
+    if(it!=Files_.end()&&!file->Content.empty()){
+        charge_memory_(it->first,file);
+        evict_memory_();
+    }
+    return file;
+}
+FileCache::Warm_Up_Stats FileCache::Warm_Up(size_t Populate_Budget){
+    Warm_Up_Stats stats={0,0,0,0.0,false,false};
+    auto begin=std::chrono::steady_clock::now();
+    uint64_t Generation;
+    size_t Cached;
+    {
+        std::shared_lock<std::shared_mutex> lock(Mutex_);
+        Generation=Generation_;
+        Cached=Files_.size();
+    }
+    //在锁外加载，查找不受影响
+    std::vector<std::pair<std::string,std::shared_ptr<const File>>> Loaded;
+    uint64_t now=now_coarse_();
+    std::error_code error;
+    for(auto it=std::filesystem::recursive_directory_iterator(Root_,error);
+        !error&&it!=std::filesystem::recursive_directory_iterator();it.increment(error)){
+        if(!it->is_regular_file(error)){
+            continue;
+        }
+        std::string Path=it->path().string().substr(Root_.size());
+        std::string_view Base;
+        if(!is_canonical_(Path)||(Precompressed_&&is_sibling_(Path,Base))){
+            //预压缩文件随原文件加载
+            continue;
+        }
+        {
+            //已经缓存的项（及其已生成的响应头）保留，不重新加载
+            std::shared_lock<std::shared_mutex> lock(Mutex_);
+            if(Files_.find(Path)!=Files_.end()){
+                continue;
+            }
+        }
+        if(Cached+Loaded.size()>=MAX_ENTRIES_){
+            stats.Capped=true;
+            break;
+        }
+        size_t size=it->file_size(error);
+        bool populate=size>Small_Max_&&stats.Populated_Bytes+size<=Populate_Budget;
+        auto file=load_(Root_+Path,Precompressed_,Small_Max_,populate);
+        if(!file){
+            continue;
+        }
+        file->Last_Used.store(now,std::memory_order_relaxed);
+        if(populate&&file->Data){
+            stats.Populated_Bytes+=size;
+        }
+        Loaded.emplace_back(std::move(Path),std::move(file));
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(Mutex_);
+        if(Generation!=Generation_){
+            //加载期间有文件变化，加载的项中可能有过期的，放弃（之后按需加载）
+            stats.Discarded=true;
+        }else{
+            //并入缓存：加载期间按需加载的项保留，总项数不超过上限
+            for(auto& [path,file]:Loaded){
+                if(Files_.size()>=MAX_ENTRIES_){
+                    stats.Capped=true;
+                    break;
+                }
+                auto [it,inserted]=Files_.try_emplace(std::move(path),std::move(file));
+                if(!inserted){
+                    continue;
+                }
+                ++stats.Files;
+                if(!it->second->Content.empty()){
+                    stats.Memory_Bytes+=it->second->Content.size();
+                    charge_memory_(it->first,it->second);
+                }
+            }
+            evict_memory_();
+        }
+    }
+    stats.Milliseconds=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
+uint64_t FileCache::now_coarse_(){
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE,&now);
+    return static_cast<uint64_t>(now.tv_sec)*1000+now.tv_nsec/1000000;
+}
+void FileCache::charge_memory_(const std::string& Path,const std::shared_ptr<const File>& Entry){
+    if(Entry->Content.empty()||Entry->Budget){
+        return;
+    }
+    //原文件与内存中的预压缩版本各自计入，各自释放时退还；之后生成的响应头由Store_Header计入
+    for(const File* file:{Entry.get(),Entry->Brotli.get(),Entry->Gzip.get()}){
+        if(file&&!file->Content.empty()&&!file->Budget){
+            size_t bytes=file->Content.size()+file->Header_Bytes.load(std::memory_order_relaxed);
+            file->Budget=&Memory_Bytes_;
+            file->Budget_Bytes.store(bytes,std::memory_order_relaxed);
+            Memory_Bytes_.fetch_add(bytes,std::memory_order_relaxed);
+        }
+    }
+    Memory_Queue_.push_back(Memory_Entry_{Path,Entry,Entry->Last_Used.load(std::memory_order_relaxed)});
+    if(Memory_Queue_.size()>2*Files_.size()+64){
+        //失效与替换留下的过期项太多：压缩队列（均摊到每次入队为常数）
+        std::erase_if(Memory_Queue_,[this](const Memory_Entry_& Item){
+            auto file=Item.Entry.lock();
+            auto it=file?Files_.find(Item.Path):Files_.end();
+            return it==Files_.end()||it->second!=file;
+        });
+    }
+}
+void FileCache::evict_memory_(){
+    //只在放入新的内存文件时检查，查找路径上没有额外开销
+    int64_t over=Memory_Bytes_.load(std::memory_order_relaxed)-static_cast<int64_t>(Small_Budget_);
+    //一次淘汰中每项最多得到一次第二次机会
+    size_t chances=Memory_Queue_.size();
+    while(over>0&&!Memory_Queue_.empty()){
+        Memory_Entry_ entry=std::move(Memory_Queue_.front());
+        Memory_Queue_.pop_front();
+        std::shared_ptr<const File> file=entry.Entry.lock();
+        if(!file){
+            //已释放，计入的字节数已经退还
+            continue;
+        }
+        auto it=Files_.find(entry.Path);
+        if(it==Files_.end()||it->second!=file){
+            //已失效或被替换，正在发送它的响应结束后退还
+            over-=file->Memory_Bytes();
+            continue;
+        }
+        uint64_t used=file->Last_Used.load(std::memory_order_relaxed);
+        if(used!=entry.Stamp&&chances>0){
+            //入队后被使用过：移到队尾
+            --chances;
+            entry.Stamp=used;
+            Memory_Queue_.push_back(std::move(entry));
+            continue;
+        }
+        //被淘汰的文件仍被正在发送它的响应持有，发送完后释放并退还
+        over-=file->Memory_Bytes();
+        Files_.erase(it);
+    }
+}
+size_t FileCache::Size() const{
+    std::shared_lock<std::shared_mutex> lock(Mutex_);
+    return Files_.size();
+}
+void FileCache::watch_tree_(const std::string& Dir){
+    const uint32_t mask=IN_MODIFY|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|
+                        IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR;
+    int wd=inotify_add_watch(InotifyFd_,(Root_+Dir).data(),mask);
+    if(wd<0){
+        return;
+    }
+    Watch_Dirs_[wd]=Dir;
+    std::error_code error;
+    for(auto& entry:std::filesystem::directory_iterator(Root_+Dir,error)){
+        if(entry.is_directory(error)){
+            watch_tree_(Dir+"/"+entry.path().filename().string());
+        }
+    }
+}
+void FileCache::invalidate_(const std::string& Path,bool Tree){
+    std::unique_lock<std::shared_mutex> lock(Mutex_);
+    ++Generation_;
+    Files_.erase(Path);
+    std::string_view Base;
+    if(is_sibling_(Path,Base)){
+        //预压缩版本变化：原文件的缓存项引用着它，一同失效
+        Files_.erase(std::string(Base));
+    }
+    if(!Tree){
+        return;
+    }
+    //目录被删除或移动：其下的全部缓存项失效
+    std::string Prefix=Path+"/";
+    for(auto it=Files_.begin();it!=Files_.end();){
+        if(it->first.compare(0,Prefix.size(),Prefix)==0){
+            it=Files_.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+void FileCache::watch_loop_(){
+    alignas(inotify_event) char buffer[8192];
+    pollfd fds[2]={{InotifyFd_,POLLIN,0},{StopFd_,POLLIN,0}};
+    while(true){
+        if(poll(fds,2,-1)<0){
+            if(errno==EINTR){
+                continue;
+            }
+            return;
+        }
+        if(fds[1].revents){
+            return;
+        }
+        ssize_t len;
+        while((len=read(InotifyFd_,buffer,sizeof(buffer)))>0){
+            for(char* ptr=buffer;ptr<buffer+len;){
+                const inotify_event* event=reinterpret_cast<const inotify_event*>(ptr);
+                ptr+=sizeof(inotify_event)+event->len;
+                if(event->mask&IN_Q_OVERFLOW){
+                    //事件丢失，全部失效
+                    std::unique_lock<std::shared_mutex> lock(Mutex_);
+                    ++Generation_;
+                    Files_.clear();
+                    continue;
+                }
+                auto it=Watch_Dirs_.find(event->wd);
+                if(it==Watch_Dirs_.end()){
+                    continue;
+                }
+                if(event->mask&IN_IGNORED){
+                    //目录已被删除，监视自动移除
+                    Watch_Dirs_.erase(it);
+                    continue;
+                }
+                if(event->len==0){
+                    //目录自身被删除或移动
+                    invalidate_(it->second,true);
+                    continue;
+                }
+                std::string path=it->second+"/"+event->name;
+                bool is_dir=event->mask&IN_ISDIR;
+                invalidate_(path,is_dir);
+                if(is_dir&&(event->mask&(IN_CREATE|IN_MOVED_TO))){
+                    //新出现的子目录也需要监视
+                    watch_tree_(path);
+                }
+            }
+        }
+    }
+}
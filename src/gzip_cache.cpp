@@ -0,0 +1,147 @@
+#include"gzip_cache.h"
+#include<zlib.h>
+#include<cinttypes>
+
+GzipCache::GzipCache():Capacity_(0),Min_Length_(0),Pool_(nullptr),Bytes_(0),Hits_(0),Misses_(0),Compressions_(0){
+}
+GzipCache& GzipCache::Instance(){
+    static GzipCache cache;
+    return cache;
+}
+void GzipCache::Init(size_t Capacity,size_t Min_Length,CoroutineThreadPool* Pool){
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Capacity_=Capacity;
+    Min_Length_=Min_Length;
+    Pool_=Pool;
+}
+std::string GzipCache::make_key_(std::string_view Path,const FileCache::File& Original){
+    char suffix[48];
+    uint64_t mtime_ns=static_cast<uint64_t>(Original.Stat.st_mtim.tv_sec)*1000000000ull+Original.Stat.st_mtim.tv_nsec;
+    snprintf(suffix,sizeof(suffix),"|%" PRIx64 "|gzip",mtime_ns);
+    return std::string(Path).append(suffix);
+}
+std::shared_ptr<const FileCache::File> GzipCache::Get(std::string_view Path,
+                                                      const std::shared_ptr<const FileCache::File>& Original){
+    if(!Original||!Original->Data||!Enabled(Original->Stat.st_size)){
+        return nullptr;
+    }
+    //命中原文件缓存项的槽：只做一次原子读取，标记最近使用，不移动LRU
+    std::shared_ptr<const FileCache::File> cached=Original->Dynamic_Gzip.load(std::memory_order_acquire);
+    if(cached||Original->Incompressible.load(std::memory_order_relaxed)){
+        if(cached&&!Original->Dynamic_Gzip_Used.load(std::memory_order_relaxed)){
+            Original->Dynamic_Gzip_Used.store(true,std::memory_order_relaxed);
+        }
+        Hits_.fetch_add(1,std::memory_order_relaxed);
+        return cached;
+    }
+    std::string key=make_key_(Path,*Original);
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        auto it=Index_.find(key);
+        if(it!=Index_.end()){
+            //缓存项重新加载过（TTL），结果放入新缓存项的槽
+            Lru_.splice(Lru_.begin(),Lru_,it->second);
+            install_(*it->second,Original);
+            Hits_.fetch_add(1,std::memory_order_relaxed);
+            return it->second->File;
+        }
+        Misses_.fetch_add(1,std::memory_order_relaxed);
+        if(!Pending_.insert(key).second){
+            //已经在压缩
+            return nullptr;
+        }
+    }
+    if(!Pool_){
+        compress_(key,Original);
+        return Original->Dynamic_Gzip.load(std::memory_order_acquire);
+    }
+    //在线程池中压缩，本次请求发送原文件；任务持有原文件的引用，映射在压缩期间有效
+    Pool_->post([this,key=std::move(key),Original]{
+        compress_(key,Original);
+    });
+    return nullptr;
+}
+void GzipCache::compress_(const std::string& Key,const std::shared_ptr<const FileCache::File>& Original){
+    const size_t length=Original->Stat.st_size;
+    std::string output;
+    z_stream stream={};
+    //windowBits加16生成gzip而不是zlib格式
+    if(deflateInit2(&stream,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)==Z_OK){
+        output.resize(deflateBound(&stream,length));
+        stream.next_in=reinterpret_cast<Bytef*>(Original->Data);
+        stream.avail_in=length;
+        stream.next_out=reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out=output.size();
+        int ret=deflate(&stream,Z_FINISH);
+        output.resize(ret==Z_STREAM_END?stream.total_out:0);
+        deflateEnd(&stream);
+    }
+    std::shared_ptr<FileCache::File> file;
+    if(!output.empty()&&output.size()<length-length/MIN_SAVING_DIVISOR_){
+        //内存中的文件：状态信息与验证器来自原文件，长度为压缩后的长度
+        file=std::make_shared<FileCache::File>();
+        file->Stat=Original->Stat;
+        file->Stat.st_size=output.size();
+        file->Content=std::move(output);
+        file->Content.shrink_to_fit();
+        file->Data=file->Content.data();
+        file->Loaded=Original->Loaded;
+        file->Encoding="gzip";
+        file->ETag=Original->ETag;
+        if(!file->ETag.empty()&&file->ETag.back()=='"'){
+            file->ETag.insert(file->ETag.size()-1,"-gz");
+        }
+        file->Last_Modified=Original->Last_Modified;
+    }
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Pending_.erase(Key);
+    Compressions_.fetch_add(1,std::memory_order_relaxed);
+    insert_(Key,std::move(file),Original);
+}
+void GzipCache::install_(Entry_& Item,const std::shared_ptr<const FileCache::File>& Original){
+    Item.Original=Original;
+    Original->Dynamic_Gzip_Used.store(false,std::memory_order_relaxed);
+    if(Item.File){
+        Original->Dynamic_Gzip.store(Item.File,std::memory_order_release);
+    }else{
+        Original->Incompressible.store(true,std::memory_order_relaxed);
+    }
+}
+void GzipCache::insert_(const std::string& Key,std::shared_ptr<const FileCache::File> File,
+                        const std::shared_ptr<const FileCache::File>& Original){
+    size_t size=File?File->Stat.st_size:0;
+    if(Index_.count(Key)){
+        return;
+    }
+    if(size>Capacity_){
+        //比整个缓存还大：按不可压缩处理，不再重复压缩
+        Original->Incompressible.store(true,std::memory_order_relaxed);
+        return;
+    }
+    Lru_.push_front(Entry_{Key,std::move(File),{}});
+    Index_.emplace(Key,Lru_.begin());
+    install_(Lru_.front(),Original);
+    Bytes_+=size;
+    while(Bytes_>Capacity_||Lru_.size()>MAX_ENTRIES_){
+        auto last=std::prev(Lru_.end());
+        std::shared_ptr<const FileCache::File> original=last->Original.lock();
+        if(original&&last!=Lru_.begin()&&original->Dynamic_Gzip_Used.exchange(false,std::memory_order_relaxed)){
+            //放入槽之后被命中过：清除标记，移到最前（第二次机会）
+            Lru_.splice(Lru_.begin(),Lru_,last);
+            continue;
+        }
+        if(original){
+            //清空原文件缓存项的槽，正在发送结果的响应仍持有引用
+            original->Dynamic_Gzip.store(nullptr,std::memory_order_release);
+            original->Incompressible.store(false,std::memory_order_relaxed);
+        }
+        Bytes_-=last->File?last->File->Stat.st_size:0;
+        Index_.erase(last->Key);
+        Lru_.erase(last);
+    }
+}
+GzipCache::Stats GzipCache::Get_Stats() const{
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Stats{Lru_.size(),Bytes_,Hits_.load(std::memory_order_relaxed),Misses_.load(std::memory_order_relaxed),
+                 Compressions_.load(std::memory_order_relaxed)};
+}
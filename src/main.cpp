@@ -1,6 +1,6 @@
 #include <unistd.h>
 #include <fstream>
-#include "/home/fatri7/Coding/coding/My_Try/webserve/include/webserver.h"
+#include "webserver.h"
 #include "json.hpp"  // nlohmann/json 库
 
 using json = nlohmann::json;
@@ -18,13 +18,43 @@ int main() {
         json config;
         config_file >> config;
 
-        // 从JSON中读取配置参数，提供默认值
-        int port = config.value("port", 1234);
-        int trig_mode = config.value("trig_mode", 3);
-        int timeout_ms = config.value("timeout_ms", 60000);
-        bool opt_linger = config.value("opt_linger", false);
-        int thread_number = config.value("thread_number", 4);
+        // 从JSON中读取配置参数，没有的键保留 ServerConfig 中的默认值
+        ServerConfig server_config;
+        server_config.port = config.value("port", server_config.port);
+        server_config.trig_mode = config.value("trig_mode", server_config.trig_mode);
+        server_config.timeout_ms = config.value("timeout_ms", server_config.timeout_ms);
+        server_config.opt_linger = config.value("opt_linger", server_config.opt_linger);
+        server_config.thread_number = config.value("thread_number", server_config.thread_number);
         bool daemon_mode = config.value("daemon_mode", false);
+        server_config.reactor_count = config.value("reactor_count", server_config.reactor_count);
+        server_config.event_backend = config.value("event_backend", server_config.event_backend);
+        server_config.file_cache_ttl_ms = config.value("file_cache_ttl_ms", server_config.file_cache_ttl_ms);
+        server_config.sendfile_threshold = config.value("sendfile_threshold", server_config.sendfile_threshold);
+        server_config.pipeline_output_limit = config.value("pipeline_output_limit", server_config.pipeline_output_limit);
+        // 按 MIME 类型的 Cache-Control max-age（秒），"*" 为其余类型的默认值
+        if (config.contains("cache_max_age") && config["cache_max_age"].is_object()) {
+            for (auto& [type, seconds] : config["cache_max_age"].items()) {
+                server_config.cache_max_age[type] = seconds.get<int>();
+            }
+        }
+
+        // 是否发送预压缩的 .br/.gz 兄弟文件（由 bin/precompress 生成）
+        server_config.precompressed = config.value("precompressed", server_config.precompressed);
+        // 动态 gzip 压缩结果的缓存容量（字节，0=不压缩）与最小压缩长度
+        server_config.gzip_cache_size = config.value("gzip_cache_size", server_config.gzip_cache_size);
+        server_config.gzip_min_length = config.value("gzip_min_length", server_config.gzip_min_length);
+        // 读入内存的小文件的长度上限与内存缓存的总字节数（0=全部使用 mmap）
+        server_config.small_file_max = config.value("small_file_max", server_config.small_file_max);
+        server_config.small_file_cache_size = config.value("small_file_cache_size", server_config.small_file_cache_size);
+        // 启动预热：开始服务前加载资源目录下的全部文件，预先建立不超过该字节数的映射的页表
+        server_config.warm_up = config.value("warm_up", server_config.warm_up);
+        server_config.warm_up_populate_bytes = config.value("warm_up_populate_bytes", server_config.warm_up_populate_bytes);
+        // 在内置的 MIME 类型之外增加或覆盖的后缀，如 ".svg": "image/svg+xml"
+        if (config.contains("mime_types") && config["mime_types"].is_object()) {
+            for (auto& [suffix, type] : config["mime_types"].items()) {
+                server_config.mime_types[suffix] = type.get<std::string>();
+            }
+        }
 
         // 如果需要以守护进程模式运行
         if (daemon_mode) {
@@ -36,7 +66,7 @@ int main() {
         }
 
         // 创建并启动服务器
-        WebServe server(port, trig_mode, timeout_ms, opt_linger, thread_number);            
+        WebServe server(server_config);
         server.start();
     } catch (const std::exception& e) {
         std::cerr << "错误: " << e.what() << std::endl;
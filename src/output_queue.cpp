@@ -0,0 +1,130 @@
+#include"output_queue.h"
+
+OutputQueue::OutputQueue():Head_(0),Size_(0){}
+
+void OutputQueue::Append(const char* Data,size_t Length,std::shared_ptr<const void> Owner){
+    if(Length==0){
+        return;
+    }
+    Segments_.push_back(Segment_{Data,nullptr,-1,0,Length,std::move(Owner)});
+    Size_+=Length;
+}
+void OutputQueue::Append_Buffer(Buffer& Buff,size_t Length){
+    if(Length==0){
+        return;
+    }
+    if(Segments_.size()>Head_&&Segments_.back().Buff==&Buff){
+        //与上一个同一Buffer的段相邻，合并
+        Segments_.back().Length+=Length;
+    }else{
+        Segments_.push_back(Segment_{nullptr,&Buff,-1,0,Length,nullptr});
+    }
+    Size_+=Length;
+}
+void OutputQueue::Append_File(int FileD,off_t Offset,size_t Length,std::shared_ptr<const void> Owner){
+    if(Length==0){
+        return;
+    }
+    Segments_.push_back(Segment_{nullptr,nullptr,FileD,Offset,Length,std::move(Owner)});
+    Size_+=Length;
+}
+int OutputQueue::Fill_Iov_(){
+    //同一个Buffer的多个段在其中依次排列，记录每个Buffer已经用到的位置
+    Buffer* buffers[MAX_BUFFERS_];
+    size_t offsets[MAX_BUFFERS_];
+    int buffer_count=0;
+    Iov_.clear();
+    for(size_t i=Head_;i<Segments_.size()&&Iov_.size()<static_cast<size_t>(MAX_IOV_);++i){
+        const Segment_& segment=Segments_[i];
+        if(segment.File_Fd>=0){
+            break;
+        }
+        const char* data=segment.Data;
+        if(segment.Buff){
+            int k=0;
+            while(k<buffer_count&&buffers[k]!=segment.Buff){
+                ++k;
+            }
+            if(k==buffer_count){
+                if(buffer_count==MAX_BUFFERS_){
+                    break;
+                }
+                buffers[k]=segment.Buff;
+                offsets[k]=0;
+                ++buffer_count;
+            }
+            data=segment.Buff->Where_Did_We_Read()+offsets[k];
+            offsets[k]+=segment.Length;
+        }
+        Iov_.push_back(iovec{const_cast<char*>(data),segment.Length});
+    }
+    return static_cast<int>(Iov_.size());
+}
+ssize_t OutputQueue::Send(int FileD,int* Errno){
+    if(Head_==Segments_.size()){
+        return 0;
+    }
+    ssize_t length;
+    const Segment_& head=Segments_[Head_];
+    if(head.File_Fd>=0){
+        //文件内容由内核直接从页缓存发送，偏移在Consume中推进
+        off_t offset=head.File_Offset;
+        length=sendfile(FileD,head.File_Fd,&offset,head.Length);
+        if(length==0){
+            //文件在发送过程中被截断，剩余内容再也读不到：按I/O错误处理，由调用者关闭连接
+            *Errno=EIO;
+            return -1;
+        }
+    }else{
+        int count=Fill_Iov_();
+        if(Head_+count<Segments_.size()){
+            //后面还有段（文件段或超出IOV_MAX的部分），MSG_MORE让内核把它们合并发送
+            msghdr message={};
+            message.msg_iov=Iov_.data();
+            message.msg_iovlen=count;
+            length=sendmsg(FileD,&message,MSG_MORE|MSG_NOSIGNAL);
+        }else{
+            length=writev(FileD,Iov_.data(),count);
+        }
+    }
+    if(length<0){
+        *Errno=errno;
+    }
+    return length;
+}
+void OutputQueue::Consume(size_t Length){
+    assert(Length<=Size_);
+    Size_-=Length;
+    while(Length>0){
+        Segment_& segment=Segments_[Head_];
+        size_t step=Length<segment.Length?Length:segment.Length;
+        if(segment.Buff){
+            segment.Buff->Update_ReadPos(step);
+        }else if(segment.File_Fd>=0){
+            segment.File_Offset+=step;
+        }else{
+            segment.Data+=step;
+        }
+        segment.Length-=step;
+        Length-=step;
+        if(segment.Length==0){
+            segment.Owner.reset();
+            ++Head_;
+        }
+    }
+    if(Head_==Segments_.size()){
+        //全部发送完，复用段数组
+        Segments_.clear();
+        Head_=0;
+    }
+}
+const iovec* OutputQueue::Build_Iov(int* Count){
+    *Count=Fill_Iov_();
+    return Iov_.data();
+}
+void OutputQueue::Clear(){
+    Segments_.clear();
+    Iov_.clear();
+    Head_=0;
+    Size_=0;
+}
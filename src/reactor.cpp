@@ -0,0 +1,367 @@
+#include"reactor.h"
+Reactor::Reactor(int port,uint32_t listen_event,uint32_t connection_event,int timeout_ms,
+                 bool opt_linger,bool reuse_port,CoroutineThreadPool* threadpool,const std::string& backend):
+port_(port),open_linger_(opt_linger),reuse_port_(reuse_port),time_out_ms_(timeout_ms),close_or_not_(false),
+listen_fd_(-1),listen_event_(listen_event),connection_event_(connection_event),
+timer_(new TimerManager()),poller_(create_backend_(backend)),threadpool_(threadpool),
+users_(ConnectionSlab::Default_Capacity(max_fd_)),wakeup_fd_(-1){
+    if(poller_->Is_Completion_Based()){
+        //完成式后端的数据与写提交都属于本线程，不交给线程池
+        threadpool_=nullptr;
+    }
+    if(threadpool_){
+        //工作线程交还待关闭的连接时唤醒本线程
+        wakeup_fd_=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+        if(wakeup_fd_<0||!poller_->AddFd(wakeup_fd_,EPOLLIN)){
+            close_or_not_=true;
+            return;
+        }
+    }
+    if(!init_socket_()){
+        close_or_not_=true;
+    }
+}
+Reactor::~Reactor(){
+    if(listen_fd_>=0){
+        close(listen_fd_);
+    }
+    if(wakeup_fd_>=0){
+        close(wakeup_fd_);
+    }
+    close_or_not_=true;
+}
+std::unique_ptr<EventBackend> Reactor::create_backend_(const std::string& backend){
+    if(backend=="io_uring"){
+        auto uring=std::make_unique<UringPoller>();
+        if(uring->Is_Ready()){
+            return uring;
+        }
+        std::cerr<<"io_uring unavailable, falling back to epoll"<<std::endl;
+    }
+    return std::make_unique<Epoller>();
+}
+bool Reactor::is_ready() const{
+    return !close_or_not_;
+}
+void Reactor::send_error_(int fd,const char* information){
+    assert(fd>0);
+    close(fd);
+}
+void Reactor::close_connection_(HttpConnection* client){
+    assert(client);
+    //删除连接的定时器，避免它之后对已关闭或被新连接复用的槽触发（在超时回调中调用时它已被删除，为空操作）
+    timer_->cancel(client->get_Fd());
+    if(poller_->Is_Completion_Based()){
+        //完成式后端：已提交的writev可能仍在引用输出队列与写缓冲区，交给后端保持到它完成
+        poller_->Retire_Writev(client->get_Fd(),client->release_output());
+    }
+    //epoll不会再监听这个文件描述符的事件
+    poller_->DelFd(client->get_Fd());
+    //关闭连接并释放相关资源
+    client->close_httpconnection();
+}
+void Reactor::request_close_(HttpConnection* client){
+    assert(client);
+    if(client->request_close()){
+        //协程挂起且没有投递给工作线程，可以直接关闭
+        close_connection_(client);
+    }
+    //否则协程正在工作线程上运行，它挂起后由该线程交还
+}
+void Reactor::hand_back_(HttpConnection* client){
+    if(!threadpool_){
+        //本线程恢复的协程，直接关闭
+        close_connection_(client);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(closing_mutex_);
+        closing_.push_back(client);
+    }
+    uint64_t one=1;
+    ssize_t ret=write(wakeup_fd_,&one,sizeof(one));
+    (void)ret;
+}
+void Reactor::handle_wakeup_(){
+    uint64_t count;
+    ssize_t ret=read(wakeup_fd_,&count,sizeof(count));
+    (void)ret;
+    std::vector<HttpConnection*> closing;
+    {
+        std::lock_guard<std::mutex> lock(closing_mutex_);
+        closing.swap(closing_);
+    }
+    for(HttpConnection* client:closing){
+        close_connection_(client);
+    }
+}
+void Reactor::add_client_connection_(int fd,sockaddr_in addr){
+    assert(fd>0);
+    HttpConnection* client=users_.Get(fd);
+    if(!client){
+        //描述符超出连接表容量
+        send_error_(fd,"erver busy!");
+        return;
+    }
+    //调用 HttpConnection 对象的 init_httpconnection 方法，初始化与客户端连接相关的信息
+    //完成式后端只提交writev，不使用sendfile
+    client->init_httpconnection(fd,addr,!poller_->Is_Completion_Based());
+    if(!poller_->Is_Completion_Based()){
+        //就绪式后端：协程先挂起，第一次可读事件时开始执行
+        client->attach_coroutine(serve_(client));
+    }
+    //检查是否设置了超时时间
+    if(time_out_ms_>0){
+        //如果设置了超时时间，就添加一个定时器，当超时发生时，调用 Reactor::request_close_ 方法关闭连接
+        timer_->add_timer(fd,time_out_ms_,std::bind(&Reactor::request_close_,this,client));
+    }
+    //将文件描述符添加到 epoll 的监听列表中，监听可读事件和连接事件（可能是边缘触发或水平触发，取决于 connection_event_ 的值）
+    poller_->AddFd(fd,EPOLLIN|connection_event_);
+    //将文件描述符设置为非阻塞模式 I/O 操作不会阻塞进程
+    set_fd_nonblock_(fd);
+}
+void Reactor::handle_listen_(){
+    struct sockaddr_in addr;
+    socklen_t length=sizeof(addr);
+    //如果监听套接字设置为边缘触发模式（EPOLLET），则循环将继续接受连接，直到没有更多连接可接受
+    do{
+        //调用 accept 函数接受新的连接。如果成功，返回一个新的文件描述符用于与客户端通信
+        int fd=accept(listen_fd_,(sockaddr*)&addr,&length);
+        if(fd<=0){
+            //检查 accept 是否成功
+            return;
+        }else if(HttpConnection::user_count>=max_fd_){
+            //检查当前用户数是否达到服务器允许的最大文件描述符数。如果是，则发送错误消息给客户端并关闭连接。
+            send_error_(fd,"erver busy!");
+            return;
+        }else{
+            //调用 add_client_connection_ 函数来添加新的客户端连接
+            add_client_connection_(fd,addr);
+        }
+    }while(listen_event_& EPOLLET);
+}
+// 处理可读/可写事件（单Reactor模式下投递到线程池）
+void Reactor::handle_ready_(HttpConnection* client){
+    assert(client);
+    if(client->is_closing()){
+        //已请求关闭（定时器可能已经触发），等待恢复协程的线程交还
+        return;
+    }
+    extent_time_(client); // 更新连接活跃时间
+    if(!client->try_dispatch()){
+        //协程仍在工作线程上运行（刚重新注册就来了事件），由该线程再恢复一次
+        return;
+    }
+    if(!threadpool_){
+        //多Reactor模式：连接只属于本线程，直接恢复
+        resume_(client);
+        return;
+    }
+    //投递到线程池：回调直接内联存放在任务中，不分配内存
+    threadpool_->post([this, client] {
+        resume_(client);
+    });
+}
+void Reactor::extent_time_(HttpConnection* client){
+    assert(client);
+    if(time_out_ms_>0){
+        timer_->update(client->get_Fd(),time_out_ms_);
+    }
+}
+IoCoroutine Reactor::serve_(HttpConnection* client){
+    int error=0;
+    for(;;){
+        ssize_t ret=co_await client->async_read(&error);
+        if(ret<=0&&error!=EAGAIN){
+            //对端关闭或出错
+            co_return;
+        }
+        //处理读缓冲区中所有完整的请求，请求不完整时回去继续读
+        while(client->handle_httpconnection()){
+            while(client->get_write_length()>0){
+                ret=co_await client->async_write(&error);
+                if(ret<0&&error!=EAGAIN){
+                    co_return;
+                }
+            }
+            if(!client->get_alive_status()){
+                co_return;
+            }
+        }
+    }
+}
+void Reactor::resume_(HttpConnection* client){
+    assert(client);
+    for(;;){
+        if(!client->resume_coroutine()){
+            //协程结束：标记关闭后交还Reactor线程关闭
+            client->request_close();
+            hand_back_(client);
+            return;
+        }
+        //协程已经挂起，此时才重新注册，EPOLLONESHOT保证下一次事件到来前不会有人再恢复它；
+        //回到空闲之前Reactor线程不会关闭连接，描述符不会被复用
+        poller_->ModFd(client->get_Fd(),connection_event_|client->get_waiting_events());
+        uint32_t state=client->finish_dispatch();
+        if(state==0){
+            //已回到空闲，之后不能再访问连接
+            return;
+        }
+        if(state&HttpConnection::DISPATCH_CLOSING){
+            //运行期间超时或对端挂断
+            hand_back_(client);
+            return;
+        }
+        //重新注册后马上又有事件（已由Reactor线程记下），再恢复一次
+    }
+}
+void Reactor::on_process_(HttpConnection* client){
+    //完成式后端：响应生成后直接提交writev，recv一直有效无需重新注册
+    if(client->handle_httpconnection()){
+        int count=0;
+        const iovec* iov=client->get_iov(&count);
+        poller_->Submit_Writev(client->get_Fd(),iov,count);
+    }
+}
+void Reactor::handle_completion_(int index){
+    int fd=poller_->Get_Event_FileD(index);
+    uint32_t events=poller_->Get_Event_events(index);
+    int result=poller_->Get_Event_Result(index);
+    if(fd==listen_fd_){
+        //multishot accept 的结果就是新连接的描述符
+        sockaddr_in addr={0};
+        if(HttpConnection::user_count>=max_fd_){
+            send_error_(result,"erver busy!");
+        }else{
+            add_client_connection_(result,addr);
+        }
+        return;
+    }
+    HttpConnection* client=users_.Find(fd);
+    if(!client){
+        return;
+    }
+    if(events&(EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
+        close_connection_(client);
+        return;
+    }
+    extent_time_(client);
+    if(events&EPOLLIN){
+        //数据已经由内核接收到后端缓冲区，拷贝到连接的读缓冲区
+        client->fill_read_buffer(poller_->Get_Event_Data(index),result);
+        if(client->get_write_length()==0){
+            //上一个响应已写完才处理新请求
+            on_process_(client);
+        }
+    }else if(events&EPOLLOUT){
+        if(result<0){
+            close_connection_(client);
+            return;
+        }
+        client->update_iov(result);
+        if(client->get_write_length()>0){
+            //部分写出，继续提交剩余部分
+            int count=0;
+            const iovec* iov=client->get_iov(&count);
+            poller_->Submit_Writev(fd,iov,count);
+        }else if(client->get_alive_status()){
+            on_process_(client);
+        }else{
+            close_connection_(client);
+        }
+    }
+}
+bool Reactor::init_socket_(){
+    int ret;
+    sockaddr_in addr;
+    if(port_>65535||port_<1024){
+        return false;
+    }
+    addr.sin_family=AF_INET;
+    addr.sin_addr.s_addr=htonl(INADDR_ANY);
+    addr.sin_port=htons(port_);
+    linger opt_linger={0};
+    if(open_linger_){
+        opt_linger.l_linger=1;
+        opt_linger.l_onoff=1;
+    }
+    listen_fd_=socket(AF_INET,SOCK_STREAM,0);
+    if(listen_fd_<0){
+        return false;
+    }
+    ret=setsockopt(listen_fd_,SOL_SOCKET,SO_LINGER,&opt_linger,sizeof(opt_linger));
+    if(ret<0){
+        close(listen_fd_);
+        return false;
+    }
+    int optval=1;
+    ret=setsockopt(listen_fd_,SOL_SOCKET,SO_REUSEADDR,(const void*)&optval,sizeof(int));
+    if(ret==-1){
+        close(listen_fd_);
+        return false;
+    }
+    if(reuse_port_){
+        //多个Reactor的监听套接字绑定同一端口，由内核按连接哈希分发
+        ret=setsockopt(listen_fd_,SOL_SOCKET,SO_REUSEPORT,(const void*)&optval,sizeof(int));
+        if(ret==-1){
+            close(listen_fd_);
+            return false;
+        }
+    }
+    ret=bind(listen_fd_,(sockaddr*)&addr,sizeof(addr));
+    if(ret<0){
+        close(listen_fd_);
+        return false;
+    }
+    ret=listen(listen_fd_,6);
+    if(ret<0){
+        close(listen_fd_);
+        return false;
+    }
+    ret=poller_->AddListenFd(listen_fd_,listen_event_|EPOLLIN);
+    if(ret==0){
+        close(listen_fd_);
+        return false;
+    }
+    set_fd_nonblock_(listen_fd_);
+    return true;
+}
+int Reactor::set_fd_nonblock_(int fd){
+    assert(fd>0);
+    return fcntl(fd,F_SETFL,fcntl(fd,F_GETFD,0)|O_NONBLOCK);
+}
+void Reactor::loop(){
+    int time_ms=-1;
+    while(!close_or_not_){
+        if(time_out_ms_>0){
+            time_ms=timer_->get_next_timer_handle();
+        }
+        int event_cnt=poller_->Wait(time_ms);
+        for(int i=0;i<event_cnt;++i){
+            if(poller_->Is_Completion_Based()){
+                handle_completion_(i);
+                continue;
+            }
+            int fd=poller_->Get_Event_FileD(i);
+            uint32_t events=poller_->Get_Event_events(i);
+            if(fd==listen_fd_){
+                handle_listen_();
+                continue;
+            }
+            if(fd==wakeup_fd_){
+                handle_wakeup_();
+                continue;
+            }
+            //按描述符直接下标取得连接
+            HttpConnection* client=users_.Find(fd);
+            assert(client);
+            if(events&(EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
+                request_close_(client);
+            }else if(events&(EPOLLIN|EPOLLOUT)){
+                handle_ready_(client);
+            }else{
+                std::cout<<"Unexpected event"<<std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include"scanner.h"
+#if defined(__x86_64__)||defined(__i386__)
+#include<immintrin.h>
+#define SCANNER_X86 1
+#endif
+
+//把位掩码中的分隔符偏移写入Out；写满时把Pos停在第一个未写入的分隔符上并返回false
+static inline bool emit_mask_(uint32_t Mask,size_t Block,size_t& Pos,uint32_t* Out,size_t Capacity,size_t& Count){
+    while(Mask){
+        size_t Offset=Block+__builtin_ctz(Mask);
+        if(Count==Capacity){
+            Pos=Offset;
+            return false;
+        }
+        Out[Count++]=static_cast<uint32_t>(Offset);
+        Mask&=Mask-1;
+    }
+    return true;
+}
+
+size_t DelimiterScanner::Scan_Scalar(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+    size_t Count=0;
+    for(;Pos<End;++Pos){
+        char ch=Data[Pos];
+        if(ch=='\r'||ch=='\n'||ch==':'){
+            if(Count==Capacity){
+                break;
+            }
+            Out[Count++]=static_cast<uint32_t>(Pos);
+        }
+    }
+    return Count;
+}
+
+#ifdef SCANNER_X86
+__attribute__((target("sse4.2")))
+size_t DelimiterScanner::Scan_Sse42(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+    size_t Count=0;
+    //pcmpestrm按字符集"\r\n:"匹配，每个命中的字节对应掩码中的一位
+    const __m128i Set=_mm_setr_epi8('\r','\n',':',0,0,0,0,0,0,0,0,0,0,0,0,0);
+    while(Pos+16<=End){
+        __m128i Block=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Data+Pos));
+        __m128i Hit=_mm_cmpestrm(Set,3,Block,16,_SIDD_UBYTE_OPS|_SIDD_CMP_EQUAL_ANY|_SIDD_BIT_MASK);
+        if(!emit_mask_(static_cast<uint32_t>(_mm_cvtsi128_si32(Hit)),Pos,Pos,Out,Capacity,Count)){
+            return Count;
+        }
+        Pos+=16;
+    }
+    //不足16字节的尾部
+    return Count+Scan_Scalar(Data,Pos,End,Out+Count,Capacity-Count);
+}
+
+__attribute__((target("avx2")))
+size_t DelimiterScanner::Scan_Avx2(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+    size_t Count=0;
+    const __m256i Cr=_mm256_set1_epi8('\r');
+    const __m256i Lf=_mm256_set1_epi8('\n');
+    const __m256i Colon=_mm256_set1_epi8(':');
+    while(Pos+32<=End){
+        __m256i Block=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Data+Pos));
+        __m256i Hit=_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Block,Cr),_mm256_cmpeq_epi8(Block,Lf)),
+                                    _mm256_cmpeq_epi8(Block,Colon));
+        if(!emit_mask_(static_cast<uint32_t>(_mm256_movemask_epi8(Hit)),Pos,Pos,Out,Capacity,Count)){
+            return Count;
+        }
+        Pos+=32;
+    }
+    //不足32字节的尾部
+    return Count+Scan_Scalar(Data,Pos,End,Out+Count,Capacity-Count);
+}
+
+bool DelimiterScanner::Has_Sse42(){
+    return __builtin_cpu_supports("sse4.2");
+}
+bool DelimiterScanner::Has_Avx2(){
+    return __builtin_cpu_supports("avx2");
+}
+#else
+size_t DelimiterScanner::Scan_Sse42(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+    return Scan_Scalar(Data,Pos,End,Out,Capacity);
+}
+size_t DelimiterScanner::Scan_Avx2(const char* Data,size_t& Pos,size_t End,uint32_t* Out,size_t Capacity){
+    return Scan_Scalar(Data,Pos,End,Out,Capacity);
+}
+bool DelimiterScanner::Has_Sse42(){
+    return false;
+}
+bool DelimiterScanner::Has_Avx2(){
+    return false;
+}
+#endif
+
+DelimiterScanner::Scan_Func DelimiterScanner::Select_(){
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+#endif
+    if(Has_Avx2()){
+        return Scan_Avx2;
+    }
+    if(Has_Sse42()){
+        return Scan_Sse42;
+    }
+    return Scan_Scalar;
+}
+const DelimiterScanner::Scan_Func DelimiterScanner::Impl_=DelimiterScanner::Select_();
+
+const char* DelimiterScanner::Name(){
+    if(Impl_==Scan_Avx2){
+        return "avx2";
+    }
+    if(Impl_==Scan_Sse42){
+        return "sse4.2";
+    }
+    return "scalar";
+}
@@ -1,134 +1,236 @@
 #include"timer.h"
 
-void TimerManager::siftup_(size_t index){
-    assert(index>=0&&index<heap_.size());
-    //计算当前节点的父节点索引。在二叉堆中，父节点的索引是(子节点索引 - 1) / 2
-    size_t j=(index-1)/2;
-    while (j>=0)
-    {
-        //只要当前节点有父节点
-        if(heap_[j]<heap_[index]){
-            //父节点的值小于当前节点的值，说明堆的性质已经满足，不需要继续调整
-            break;
+//在nbits位的循环位图中，从from之后（不含from）找第一个置位的位，返回距离(1..nbits)，没有时返回-1
+static int next_set_bit_(const uint64_t* words,int nbits,int from){
+    for(int d=1;d<=nbits;){
+        int bit=(from+d)&(nbits-1);
+        //取出从bit开始的本字剩余部分
+        uint64_t word=words[bit>>6]>>(bit&63);
+        if(word){
+            int offset=d+__builtin_ctzll(word);
+            return offset<=nbits?offset:-1;
+        }
+        d+=64-(bit&63);
+    }
+    return -1;
+}
+
+TimerManager::TimerManager():current_(0),count_(0),start_(std::chrono::steady_clock::now()){
+    //预分配容量
+    nodes_.reserve(64);
+    clear();
+}
+int64_t TimerManager::now_() const{
+    return std::chrono::duration_cast<ms>(std::chrono::steady_clock::now()-start_).count();
+}
+int TimerManager::slot_of_(int level,int index){
+    return level==0?index:ROOT_SIZE_+(level-1)*LEVEL_SIZE_+index;
+}
+void TimerManager::link_(int id){
+    timer_node& node=nodes_[id];
+    int64_t expire=node.expire;
+    if(expire<=current_){
+        //已经到期：放到下一个刻度处理
+        expire=current_+1;
+    }
+    if(expire-current_>MAX_SPAN_){
+        //超出时间轮的范围：先放在最远的槽，到时再按真实的过期时间重新放入
+        expire=current_+MAX_SPAN_;
+    }
+    int64_t delta=expire-current_;
+    int level=0;
+    int index=expire&(ROOT_SIZE_-1);
+    if(delta>=ROOT_SIZE_){
+        //第level层（level>=1）存放距离小于2^(8+6*level)的定时器，每个槽宽2^(8+6*(level-1))毫秒
+        for(level=1;level<LEVELS_;++level){
+            int shift=ROOT_BITS_+level*LEVEL_BITS_;
+            if(delta<(int64_t(1)<<shift)||level==LEVELS_-1){
+                index=(expire>>(shift-LEVEL_BITS_))&(LEVEL_SIZE_-1);
+                break;
+            }
+        }
+    }
+    int slot=slot_of_(level,index);
+    node.slot=slot;
+    node.prev=-1;
+    node.next=head_[slot];
+    if(node.next!=-1){
+        nodes_[node.next].prev=id;
+    }
+    head_[slot]=id;
+    bitmap_[level][index>>6]|=uint64_t(1)<<(index&63);
+}
+void TimerManager::unlink_(int id){
+    timer_node& node=nodes_[id];
+    if(node.prev!=-1){
+        nodes_[node.prev].next=node.next;
+    }else{
+        head_[node.slot]=node.next;
+    }
+    if(node.next!=-1){
+        nodes_[node.next].prev=node.prev;
+    }
+    if(head_[node.slot]==-1){
+        //槽已空，清除位图中的标记
+        int level=node.slot<ROOT_SIZE_?0:(node.slot-ROOT_SIZE_)/LEVEL_SIZE_+1;
+        int index=level==0?node.slot:(node.slot-ROOT_SIZE_)%LEVEL_SIZE_;
+        bitmap_[level][index>>6]&=~(uint64_t(1)<<(index&63));
+    }
+    node.prev=node.next=-1;
+}
+void TimerManager::cascade_(int level,int index){
+    int slot=slot_of_(level,index);
+    int id=head_[slot];
+    head_[slot]=-1;
+    bitmap_[level][index>>6]&=~(uint64_t(1)<<(index&63));
+    while(id!=-1){
+        int next=nodes_[id].next;
+        link_(id);
+        id=next;
+    }
+}
+void TimerManager::tick_(){
+    ++current_;
+    int index=current_&(ROOT_SIZE_-1);
+    if(index==0){
+        //第0层转完一圈：把上一层当前槽中的定时器下移，逐层进位
+        for(int level=1;level<LEVELS_;++level){
+            int shift=ROOT_BITS_+(level-1)*LEVEL_BITS_;
+            int upper=(current_>>shift)&(LEVEL_SIZE_-1);
+            cascade_(level,upper);
+            if(upper!=0){
+                break;
+            }
         }
-        //交换这两个节点的内容，以维护堆的性质
-        swap_node_(index,j);
-        //准备进行下一轮的比较和交换
-        index=j;
-        j=(index-1)/2;
-    }
-}
-bool TimerManager::siftdown_(size_t index,size_t n){
-    assert(index>=0&&index<heap_.size());
-    assert(n>=0&&n<=heap_.size());
-    size_t i=index;
-    //j是i的左子节点的索引
-    size_t j=i*2+1;
-    while(j<n){
-        if(j+1<n&&heap_[j+1]<heap_[j]){
-            //检查右子节点是否存在并且是否小于左子节点，如果是，则将 j 更新为右子节点的索引
-            j++;
-        }else if(heap_[i]<heap_[j]){
-            //当前节点小于其子节点，则不需要继续下沉，跳出循环
+    }
+    int slot=slot_of_(0,index);
+    while(head_[slot]!=-1){
+        int id=head_[slot];
+        unlink_(id);
+        timer_node& node=nodes_[id];
+        if(node.expire>current_){
+            //刷新过的定时器：按新的过期时间重新放入
+            link_(id);
+            continue;
+        }
+        node.slot=-1;
+        --count_;
+        //回调中可能添加定时器使nodes_扩容，先取出回调
+        timeout_callback call_back=std::move(node.call_back);
+        node.call_back=nullptr;
+        call_back();
+    }
+}
+int64_t TimerManager::next_tick_() const{
+    if(count_==0){
+        return -1;
+    }
+    int64_t best=-1;
+    //第0层：槽index在刻度低8位等于index时处理
+    int offset=next_set_bit_(bitmap_[0],ROOT_SIZE_,current_&(ROOT_SIZE_-1));
+    if(offset>0){
+        best=current_+offset;
+    }
+    //上层：第level层的槽在刻度为槽宽的整数倍、且对应位等于槽号时下移
+    for(int level=1;level<LEVELS_;++level){
+        int shift=ROOT_BITS_+(level-1)*LEVEL_BITS_;
+        int64_t block=current_>>shift;
+        offset=next_set_bit_(bitmap_[level],LEVEL_SIZE_,block&(LEVEL_SIZE_-1));
+        if(offset>0){
+            int64_t tick=(block+offset)<<shift;
+            if(best<0||tick<best){
+                best=tick;
+            }
+        }
+    }
+    return best;
+}
+void TimerManager::advance_(){
+    int64_t now=now_();
+    while(current_<now){
+        //跳过没有任何槽需要处理的刻度
+        int64_t next=next_tick_();
+        if(next<0||next>now){
+            current_=now;
             break;
         }
-        //交换当前节点与其子节点的位置
-        swap_node_(i,j);
-        //继续下一轮
-        i=j;
-        j=i*2+1;
-    }
-    //表示节点是否发生了移动
-    return i> index;
-}
-void TimerManager::swap_node_(size_t index1,size_t index2){
-    assert(index1>=0&&index1<heap_.size());
-    assert(index2>=0&&index2<heap_.size());
-    //swap函数不会改变对象的地址，它只是交换对象的值
-    std::swap(heap_[index1],heap_[index2]);
-    //更新引用索引
-    ref_[heap_[index1].id]=index1;
-    ref_[heap_[index2].id]=index2;    
+        current_=next-1;
+        tick_();
+    }
 }
 void TimerManager::add_timer(int id,int time_out,const timeout_callback& call_back){
     assert(id>=0);
-    size_t i;
-    if(ref_.count(id)==0){
-        //新节点：堆尾插入，调整堆
-        i=heap_.size();
-        ref_[id]=i;
-        heap_.push_back({id,hr_clock::now()+ms(time_out),call_back});
-        siftup_(i);
+    if(static_cast<size_t>(id)>=nodes_.size()){
+        nodes_.resize(id+1,timer_node{0,-1,-1,-1,nullptr});
+    }
+    timer_node& node=nodes_[id];
+    if(node.slot!=-1){
+        //已有结点：从原来的槽中取出
+        unlink_(id);
     }else{
-        //已有结点：调整堆
-        i=ref_[id];
-        heap_[i].expire=hr_clock::now()+ms(time_out);
-        heap_[i].call_back=call_back;
-        if(!siftdown_(i,heap_.size())){
-            siftup_(i);
-        }
+        ++count_;
     }
+    node.expire=now_()+time_out;
+    node.call_back=call_back;
+    link_(id);
 }
 void TimerManager::work(int id){
     //删除指定id结点，并触发回调函数
-    if(heap_.empty()||ref_.count(id)==0){
+    if(id<0||static_cast<size_t>(id)>=nodes_.size()||nodes_[id].slot==-1){
         return;
     }
-    size_t i=ref_[id];
-    timer_node node=heap_[i];
-    node.call_back();
-    del_(i);
-}
-void TimerManager::del_(size_t index){
-    assert(!heap_.empty()&&index>=0&&index<heap_.size());
-    //将要删除的结点换到队尾，然后调整堆
-    size_t i=index;
-    size_t n=heap_.size()-1;
-    assert(i<=n);
-    if(i<n){
-        swap_node_(i,n);
-        if(!siftdown_(i,n)){
-            siftup_(i);
-        }
+    unlink_(id);
+    nodes_[id].slot=-1;
+    --count_;
+    timeout_callback call_back=std::move(nodes_[id].call_back);
+    nodes_[id].call_back=nullptr;
+    call_back();
+}
+void TimerManager::cancel(int id){
+    if(id<0||static_cast<size_t>(id)>=nodes_.size()||nodes_[id].slot==-1){
+        return;
     }
-    //删除队尾元素
-    ref_.erase(heap_.back().id);
-    heap_.pop_back();
+    unlink_(id);
+    nodes_[id].slot=-1;
+    nodes_[id].call_back=nullptr;
+    --count_;
 }
 void TimerManager::update(int id,int time_out){
-    assert(!heap_.empty()&&ref_.count(id)!=0);
-    //更新与id相关联的定时器的超时时间
-    heap_[ref_[id]].expire=hr_clock::now()+ms(time_out);
-    siftdown_(ref_[id],heap_.size());
-}
-void TimerManager::handle_expired_event(){
-    while(!heap_.empty()){
-        timer_node node=heap_.front();
-        if(std::chrono::duration_cast<ms>(node.expire-hr_clock::now()).count()>0){
-            //检查定时器是否到期
-            break;
-        }
-        node.call_back();
-        pop();
+    assert(id>=0&&static_cast<size_t>(id)<nodes_.size()&&nodes_[id].slot!=-1);
+    timer_node& node=nodes_[id];
+    int64_t expire=now_()+time_out;
+    if(expire>=node.expire){
+        //推后：只记录新的过期时间，所在的槽到期时再重新放入
+        node.expire=expire;
+        return;
     }
+    //提前：立即移动到新的槽
+    unlink_(id);
+    node.expire=expire;
+    link_(id);
 }
-void TimerManager::pop(){
-    assert(!heap_.empty());
-    del_(0);
+void TimerManager::handle_expired_event(){
+    advance_();
 }
 void TimerManager::clear(){
-    ref_.clear();
-    heap_.clear();
+    nodes_.clear();
+    for(int i=0;i<SLOT_COUNT_;++i){
+        head_[i]=-1;
+    }
+    for(auto& level:bitmap_){
+        for(auto& word:level){
+            word=0;
+        }
+    }
+    count_=0;
 }
 int TimerManager::get_next_timer_handle(){
     handle_expired_event();
-    ssize_t res=-1;
-    if(!heap_.empty()){
-        //如果计算结果res小于0，说明堆顶定时器已经到期，将res设置为0
-        res=std::chrono::duration_cast<ms>(heap_.front().expire-hr_clock::now()).count();
-        if(res<0){
-            res=0;
-        }
+    int64_t next=next_tick_();
+    if(next<0){
+        return -1;
     }
-    return res;
-}
\ No newline at end of file
+    //时间轮在next刻度需要处理槽（可能只是把上层的定时器下移），不会晚于最早的定时器
+    int64_t res=next-now_();
+    return res<0?0:static_cast<int>(res);
+}
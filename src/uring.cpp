@@ -0,0 +1,364 @@
+#include"uring.h"
+#include<linux/io_uring.h>
+#include<sys/syscall.h> //io_uring_setup/io_uring_enter/io_uring_register
+#include<sys/mman.h> //mmap
+#include<unistd.h> //close()
+#include<cstring>
+#include<algorithm>
+#include<sys/socket.h> //SOCK_NONBLOCK
+#include<time.h>
+
+UringPoller::UringPoller(int MaxEvents):RingFd_(-1),ready_(false),SqRing_(MAP_FAILED),SqRingSize_(0),
+CqRing_(MAP_FAILED),CqRingSize_(0),Sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),SqesSize_(0),SqLocalTail_(0),
+BufRing_(static_cast<io_uring_buf_ring*>(MAP_FAILED)),BufRingSize_(0),Buffers_(static_cast<char*>(MAP_FAILED)),
+BufTail_(0),MaxEvents_(MaxEvents){
+    assert(MaxEvents>0);
+    Events_.reserve(MaxEvents);
+    Lent_.reserve(BUFFER_COUNT);
+    //提交队列的大小与最大事件数一致，完成队列由内核取两倍
+    ready_=init_ring_(MaxEvents)&&init_buffer_ring_();
+}
+UringPoller::~UringPoller(){
+    if(Buffers_!=MAP_FAILED){
+        munmap(Buffers_,BUFFER_COUNT*BUFFER_SIZE);
+    }
+    if(BufRing_!=MAP_FAILED){
+        munmap(BufRing_,BufRingSize_);
+    }
+    if(Sqes_!=MAP_FAILED){
+        munmap(Sqes_,SqesSize_);
+    }
+    if(CqRing_!=MAP_FAILED&&CqRing_!=SqRing_){
+        munmap(CqRing_,CqRingSize_);
+    }
+    if(SqRing_!=MAP_FAILED){
+        munmap(SqRing_,SqRingSize_);
+    }
+    if(RingFd_>=0){
+        close(RingFd_);
+    }
+}
+bool UringPoller::init_ring_(unsigned Entries){
+    io_uring_params params;
+    memset(&params,0,sizeof(params));
+    RingFd_=syscall(__NR_io_uring_setup,Entries,&params);
+    if(RingFd_<0){
+        return false;
+    }
+    //等待超时依赖IORING_ENTER_EXT_ARG，完成事件不丢失依赖IORING_FEAT_NODROP
+    if(!(params.features&IORING_FEAT_EXT_ARG)||!(params.features&IORING_FEAT_NODROP)){
+        return false;
+    }
+    SqRingSize_=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+    CqRingSize_=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+    bool single_mmap=params.features&IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap){
+        //提交队列与完成队列共用一次映射
+        SqRingSize_=CqRingSize_=std::max(SqRingSize_,CqRingSize_);
+    }
+    SqRing_=mmap(nullptr,SqRingSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,RingFd_,IORING_OFF_SQ_RING);
+    if(SqRing_==MAP_FAILED){
+        return false;
+    }
+    if(single_mmap){
+        CqRing_=SqRing_;
+    }else{
+        CqRing_=mmap(nullptr,CqRingSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,RingFd_,IORING_OFF_CQ_RING);
+        if(CqRing_==MAP_FAILED){
+            return false;
+        }
+    }
+    SqesSize_=params.sq_entries*sizeof(io_uring_sqe);
+    Sqes_=static_cast<io_uring_sqe*>(mmap(nullptr,SqesSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,RingFd_,IORING_OFF_SQES));
+    if(Sqes_==MAP_FAILED){
+        return false;
+    }
+    char* sq=static_cast<char*>(SqRing_);
+    SqHead_=reinterpret_cast<unsigned*>(sq+params.sq_off.head);
+    SqTail_=reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+    SqMask_=*reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+    SqEntries_=params.sq_entries;
+    SqArray_=reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+    SqFlags_=reinterpret_cast<unsigned*>(sq+params.sq_off.flags);
+    SqLocalTail_=*SqTail_;
+    char* cq=static_cast<char*>(CqRing_);
+    CqHead_=reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+    CqTail_=reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+    CqMask_=*reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+    Cqes_=reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+    return true;
+}
+bool UringPoller::init_buffer_ring_(){
+    //缓冲区环须按页对齐，使用匿名映射
+    BufRingSize_=BUFFER_COUNT*sizeof(io_uring_buf);
+    BufRing_=static_cast<io_uring_buf_ring*>(mmap(nullptr,BufRingSize_,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0));
+    if(BufRing_==MAP_FAILED){
+        return false;
+    }
+    Buffers_=static_cast<char*>(mmap(nullptr,BUFFER_COUNT*BUFFER_SIZE,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0));
+    if(Buffers_==MAP_FAILED){
+        return false;
+    }
+    io_uring_buf_reg reg;
+    memset(&reg,0,sizeof(reg));
+    reg.ring_addr=reinterpret_cast<uint64_t>(BufRing_);
+    reg.ring_entries=BUFFER_COUNT;
+    reg.bgid=BUFFER_GROUP;
+    if(syscall(__NR_io_uring_register,RingFd_,IORING_REGISTER_PBUF_RING,&reg,1)<0){
+        return false;
+    }
+    //初始时所有缓冲区都交给内核
+    for(unsigned bid=0;bid<BUFFER_COUNT;++bid){
+        recycle_buffer_(bid);
+    }
+    return true;
+}
+bool UringPoller::Is_Ready() const{
+    return ready_;
+}
+void UringPoller::recycle_buffer_(uint16_t Bid){
+    //C++ 下 __DECLARE_FLEX_ARRAY 展开后 bufs 的偏移不为0，按内核布局直接从环首地址取缓冲区描述
+    io_uring_buf* buf=reinterpret_cast<io_uring_buf*>(BufRing_)+(BufTail_&(BUFFER_COUNT-1));
+    buf->addr=reinterpret_cast<uint64_t>(Buffers_+static_cast<size_t>(Bid)*BUFFER_SIZE);
+    buf->len=BUFFER_SIZE;
+    buf->bid=Bid;
+    ++BufTail_;
+    //发布新的尾指针，内核之后才能看到该缓冲区
+    __atomic_store_n(&BufRing_->tail,BufTail_,__ATOMIC_RELEASE);
+}
+io_uring_sqe* UringPoller::get_sqe_(){
+    unsigned head=__atomic_load_n(SqHead_,__ATOMIC_ACQUIRE);
+    if(SqLocalTail_-head>=SqEntries_){
+        //提交队列已满，先提交已有的请求
+        enter_(0,0);
+        head=__atomic_load_n(SqHead_,__ATOMIC_ACQUIRE);
+        if(SqLocalTail_-head>=SqEntries_){
+            return nullptr;
+        }
+    }
+    unsigned index=SqLocalTail_&SqMask_;
+    io_uring_sqe* sqe=&Sqes_[index];
+    memset(sqe,0,sizeof(*sqe));
+    SqArray_[index]=index;
+    ++SqLocalTail_;
+    return sqe;
+}
+int UringPoller::enter_(unsigned WaitNr,int timeoutMs){
+    unsigned to_submit=SqLocalTail_-*SqTail_;
+    bool overflow=__atomic_load_n(SqFlags_,__ATOMIC_RELAXED)&IORING_SQ_CQ_OVERFLOW;
+    if(to_submit==0&&WaitNr==0&&!overflow){
+        return 0;
+    }
+    //发布本地尾指针，内核从这里开始消费提交项
+    __atomic_store_n(SqTail_,SqLocalTail_,__ATOMIC_RELEASE);
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg,0,sizeof(arg));
+    if(WaitNr>0&&timeoutMs>=0){
+        ts.tv_sec=timeoutMs/1000;
+        ts.tv_nsec=static_cast<long long>(timeoutMs%1000)*1000000;
+        arg.ts=reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret;
+    do{
+        ret=syscall(__NR_io_uring_enter,RingFd_,to_submit,WaitNr,
+                    IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG,&arg,sizeof(arg));
+    }while(ret<0&&errno==EINTR);
+    return ret;
+}
+uint32_t UringPoller::generation_(int FileD){
+    if(static_cast<size_t>(FileD)>=Generation_.size()){
+        Generation_.resize(FileD+1024,0);
+        Writing_.resize(FileD+1024,0);
+    }
+    return Generation_[FileD];
+}
+uint64_t UringPoller::encode_(URING_OP Op,uint32_t Gen,int FileD){
+    return (static_cast<uint64_t>(Op)<<56)|(static_cast<uint64_t>(Gen&0xFFFFFF)<<32)|static_cast<uint32_t>(FileD);
+}
+bool UringPoller::arm_accept_(int FileD){
+    io_uring_sqe* sqe=get_sqe_();
+    if(!sqe){
+        return false;
+    }
+    sqe->opcode=IORING_OP_ACCEPT;
+    sqe->fd=FileD;
+    //一次提交，持续产生新连接的完成事件
+    sqe->ioprio=IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags=SOCK_NONBLOCK;
+    sqe->user_data=encode_(OP_ACCEPT,0,FileD);
+    return true;
+}
+bool UringPoller::arm_recv_(int FileD){
+    io_uring_sqe* sqe=get_sqe_();
+    if(!sqe){
+        return false;
+    }
+    sqe->opcode=IORING_OP_RECV;
+    sqe->fd=FileD;
+    //一次提交，持续接收；数据写入内核从缓冲区环中选取的缓冲区
+    sqe->ioprio=IORING_RECV_MULTISHOT;
+    sqe->flags=IOSQE_BUFFER_SELECT;
+    sqe->buf_group=BUFFER_GROUP;
+    sqe->user_data=encode_(OP_RECV,generation_(FileD),FileD);
+    return true;
+}
+bool UringPoller::AddFd(int FileD,uint32_t Events){
+    if(FileD<0) return false;
+    return arm_recv_(FileD);
+}
+bool UringPoller::AddListenFd(int FileD,uint32_t Events){
+    if(FileD<0) return false;
+    return arm_accept_(FileD);
+}
+bool UringPoller::ModFd(int FileD,uint32_t Events){
+    //multishot 请求一直有效，不需要重新注册
+    return FileD>=0;
+}
+bool UringPoller::DelFd(int FileD){
+    if(FileD<0) return false;
+    uint32_t gen=generation_(FileD);
+    //按用户数据取消该连接上仍在进行的 recv 与 writev，不依赖描述符（描述符随后即被关闭、可能被复用）
+    for(URING_OP op:{OP_RECV,OP_WRITEV}){
+        io_uring_sqe* sqe=get_sqe_();
+        if(!sqe){
+            return false;
+        }
+        sqe->opcode=IORING_OP_ASYNC_CANCEL;
+        sqe->fd=-1;
+        sqe->addr=encode_(op,gen,FileD);
+        sqe->cancel_flags=IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data=encode_(OP_CANCEL,0,FileD);
+    }
+    //旧代数的完成事件之后都会被忽略
+    Generation_[FileD]=(gen+1)&0xFFFFFF;
+    Writing_[FileD]=0;
+    //调用方随后关闭描述符：先提交仍在本地队列中的writev与取消请求，它们在描述符关闭（可能被复用）之前取得文件
+    enter_(0,0);
+    return true;
+}
+bool UringPoller::Submit_Writev(int FileD,const iovec* Iov,int Count){
+    io_uring_sqe* sqe=get_sqe_();
+    if(!sqe){
+        return false;
+    }
+    sqe->opcode=IORING_OP_WRITEV;
+    sqe->fd=FileD;
+    sqe->addr=reinterpret_cast<uint64_t>(Iov);
+    sqe->len=Count;
+    sqe->off=0;
+    sqe->user_data=encode_(OP_WRITEV,generation_(FileD),FileD);
+    Writing_[FileD]=1;
+    return true;
+}
+void UringPoller::Retire_Writev(int FileD,std::shared_ptr<const void> Owner){
+    if(FileD<0||!Owner||static_cast<size_t>(FileD)>=Writing_.size()||!Writing_[FileD]){
+        //没有进行中的writev，直接释放
+        return;
+    }
+    //内核可能仍在读取iovec与它们指向的内存，保持到这次writev的完成事件（完成或被取消）到达
+    Retired_[encode_(OP_WRITEV,generation_(FileD),FileD)]=std::move(Owner);
+}
+bool UringPoller::handle_cqe_(const io_uring_cqe& Cqe){
+    URING_OP op=static_cast<URING_OP>(Cqe.user_data>>56);
+    uint32_t gen=(Cqe.user_data>>32)&0xFFFFFF;
+    int fd=static_cast<int>(static_cast<uint32_t>(Cqe.user_data));
+    bool more=Cqe.flags&IORING_CQE_F_MORE;
+    switch(op){
+        case OP_ACCEPT:
+            if(!more){
+                //multishot accept 已终止，重新提交
+                arm_accept_(fd);
+            }
+            if(Cqe.res<0){
+                return false;
+            }
+            Events_.push_back({fd,EPOLLIN,Cqe.res,nullptr});
+            return true;
+        case OP_RECV:{
+            bool has_buffer=Cqe.flags&IORING_CQE_F_BUFFER;
+            uint16_t bid=Cqe.flags>>IORING_CQE_BUFFER_SHIFT;
+            if(gen!=generation_(fd)){
+                //连接已关闭，归还缓冲区并忽略
+                if(has_buffer) recycle_buffer_(bid);
+                return false;
+            }
+            if(Cqe.res>0&&has_buffer){
+                //缓冲区交给调用方，下一次Wait时归还
+                Lent_.push_back(bid);
+                if(!more){
+                    arm_recv_(fd);
+                }
+                Events_.push_back({fd,EPOLLIN,Cqe.res,Buffers_+static_cast<size_t>(bid)*BUFFER_SIZE});
+                return true;
+            }
+            if(has_buffer) recycle_buffer_(bid);
+            if(Cqe.res==-ENOBUFS){
+                //缓冲区暂时用尽，待归还后重新提交
+                arm_recv_(fd);
+                return false;
+            }
+            //0表示对端关闭，负数表示出错
+            Events_.push_back({fd,Cqe.res==0?static_cast<uint32_t>(EPOLLRDHUP):static_cast<uint32_t>(EPOLLERR),Cqe.res,nullptr});
+            return true;
+        }
+        case OP_WRITEV:
+            if(gen!=generation_(fd)){
+                //连接关闭时仍在进行的writev：它引用的输出到此才释放
+                Retired_.erase(Cqe.user_data);
+                return false;
+            }
+            Writing_[fd]=0;
+            Events_.push_back({fd,EPOLLOUT,Cqe.res,nullptr});
+            return true;
+        default:
+            return false;
+    }
+}
+void UringPoller::harvest_(){
+    unsigned head=*CqHead_;
+    unsigned tail=__atomic_load_n(CqTail_,__ATOMIC_ACQUIRE);
+    while(head!=tail&&Events_.size()<MaxEvents_){
+        handle_cqe_(Cqes_[head&CqMask_]);
+        ++head;
+    }
+    //通知内核这些完成项已被消费
+    __atomic_store_n(CqHead_,head,__ATOMIC_RELEASE);
+}
+int UringPoller::Wait(int TimeWait){
+    //上一批交给调用方的缓冲区已使用完毕，归还给内核
+    for(uint16_t bid:Lent_){
+        recycle_buffer_(bid);
+    }
+    Lent_.clear();
+    Events_.clear();
+    harvest_();
+    if(Events_.empty()&&TimeWait!=0){
+        //没有现成的事件：提交本批请求并等待至少一个完成事件
+        enter_(1,TimeWait);
+        harvest_();
+    }else{
+        //已有事件：只提交，不等待
+        enter_(0,0);
+    }
+    return Events_.size();
+}
+int UringPoller::Get_Event_FileD(size_t Index) const{
+    assert(Index<Events_.size());
+    return Events_[Index].fd;
+}
+uint32_t UringPoller::Get_Event_events(size_t Index) const{
+    assert(Index<Events_.size());
+    return Events_[Index].events;
+}
+bool UringPoller::Is_Completion_Based() const{
+    return true;
+}
+int UringPoller::Get_Event_Result(size_t Index) const{
+    assert(Index<Events_.size());
+    return Events_[Index].result;
+}
+const char* UringPoller::Get_Event_Data(size_t Index) const{
+    assert(Index<Events_.size());
+    return Events_[Index].data;
+}
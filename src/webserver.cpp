@@ -1,8 +1,7 @@
-
 #include"webserver.h"
-WebServe::WebServe(int port,int trig_mode,int timeout_ms,bool opt_linger,int thread_number):
-port_(port),open_linger_(opt_linger),time_out_ms_(timeout_ms),close_or_not_(false),timer_(new TimerManager()),
-m_threadpool_(std::make_unique<CoroutineThreadPool>(thread_number, 500)),epoller_(new Epoller()){
+WebServe::WebServe(const ServerConfig& config):
+port_(config.port),open_linger_(config.opt_linger),time_out_ms_(config.timeout_ms),reactor_count_(config.reactor_count),
+multi_reactor_(false),close_or_not_(false),event_backend_(config.event_backend){
     //获取当前工作目录
     srcDir_ = getcwd(nullptr, 256);  // 动态分配内存
 assert(srcDir_); 
@@ -13,13 +12,69 @@ if (len > 0 && srcDir_[len - 1] != '/') {
 strncat(srcDir_, "resources/", 11);  // 追加目录
     HttpConnection::user_count=0;
     HttpConnection::srcDir=srcDir_;
-    init_event_mode_(trig_mode);
-    if(!init_socket_()){
-        close_or_not_=true;
+    //静态资源缓存：监视资源目录，文件变化时失效；按需加载预压缩的兄弟文件，小文件读入内存
+    FileCache::Instance().Init(srcDir_,config.file_cache_ttl_ms,config.precompressed,config.small_file_max,
+                               config.small_file_cache_size);
+    if(config.warm_up){
+        //启动预热：开始服务前加载全部静态文件，第一个请求不再承担冷启动的文件系统调用与缺页
+        FileCache::Warm_Up_Stats stats=FileCache::Instance().Warm_Up(config.warm_up_populate_bytes);
+        std::cout<<"warm-up: "<<stats.Files<<" files, "<<stats.Memory_Bytes/1024<<" KB in memory, "
+                 <<stats.Populated_Bytes/1024<<" KB prefaulted, "<<stats.Milliseconds<<" ms"
+                 <<(stats.Discarded?" (files changed, discarded)":"")
+                 <<(stats.Capped?" (cache entry limit reached)":"")<<std::endl;
+    }
+    //不小于该长度的文件使用sendfile发送，小于等于0时不使用
+    HttpConnection::sendfile_threshold=config.sendfile_threshold>0?config.sendfile_threshold:0;
+    //流水线请求排队的输出上限，至少为1（每次至少处理一个请求）
+    HttpConnection::pipeline_output_limit=config.pipeline_output_limit>0?config.pipeline_output_limit:1;
+    //按MIME类型的Cache-Control max-age
+    HttpResponse::set_Cache_Control(config.cache_max_age);
+    //配置的MIME类型：与内置类型一起重新生成后缀的完美哈希表
+    if(!config.mime_types.empty()){
+        size_t suffixes=HttpResponse::set_Mime_Types(config.mime_types);
+        std::cout<<"mime types: "<<suffixes<<" suffixes"<<std::endl;
+    }
+    //对端关闭后继续写（writev/sendfile）会产生SIGPIPE，忽略它，由返回的EPIPE关闭连接
+    signal(SIGPIPE,SIG_IGN);
+    init_event_mode_(config.trig_mode);
+    //reactor_count为1时保持单Reactor模式，其余取值为多Reactor模式
+    multi_reactor_=(reactor_count_!=1);
+    if(reactor_count_<=0){
+        //reactor_count为0时每个核心一个Reactor
+        reactor_count_=std::max(1u,std::thread::hardware_concurrency());
+    }
+    if(!multi_reactor_){
+        //单Reactor模式：主线程事件循环，读写事件交给线程池
+        m_threadpool_=std::make_unique<CoroutineThreadPool>(config.thread_number, 500);
+        reactors_.emplace_back(std::make_unique<Reactor>(port_,listen_event_,connection_event_,time_out_ms_,
+                                                          open_linger_,false,m_threadpool_.get(),event_backend_));
+    }else{
+        //多Reactor模式：每个Reactor各自监听同一端口（SO_REUSEPORT），读写事件在本线程内处理
+        for(int i=0;i<reactor_count_;++i){
+            reactors_.emplace_back(std::make_unique<Reactor>(port_,listen_event_,connection_event_,time_out_ms_,
+                                                              open_linger_,true,nullptr,event_backend_));
+        }
+    }
+    //动态压缩：在线程池中压缩，结果按LRU缓存；容量为0时不压缩
+    if(config.gzip_cache_size>0&&!m_threadpool_){
+        compress_pool_=std::make_unique<CoroutineThreadPool>(1,500);
+    }
+    GzipCache::Instance().Init(config.gzip_cache_size,config.gzip_min_length,m_threadpool_?m_threadpool_.get():compress_pool_.get());
+    for(auto& reactor:reactors_){
+        if(!reactor->is_ready()){
+            close_or_not_=true;
+        }
     }
 }
 WebServe::~WebServe(){
-    close(listen_fd_);
+    for(auto& thread:reactor_threads_){
+        if(thread.joinable()){
+            thread.join();
+        }
+    }
+    reactors_.clear();
+    //线程池随WebServe销毁，之后不再压缩
+    GzipCache::Instance().Init(0,0,nullptr);
     close_or_not_=true;
     free(srcDir_);
 }
@@ -55,191 +110,37 @@ void WebServe::init_event_mode_(int trig_mode){
     //检查是否设置了边缘触发模式，按位与
     HttpConnection::isEt=(connection_event_& EPOLLET);
 }
-void WebServe::send_error_(int fd,const char* information){
-    assert(fd>0);
-    close(fd);
-}
-void WebServe::close_connection_(HttpConnection* client){
-    assert(client);
-    //epoll不会再监听这个文件描述符的事件
-    epoller_->DelFd(client->get_Fd());
-    //关闭连接并释放相关资源
-    client->close_httpconnection();
-}
-void WebServe::add_client_connection_(int fd,sockaddr_in addr){
-    assert(fd>0);
-    //调用 HttpConnection 对象的 init_httpconnection 方法，初始化与客户端连接相关的信息
-    users_[fd].init_httpconnection(fd,addr);
-    //检查是否设置了超时时间
-    if(time_out_ms_>0){
-        //如果设置了超时时间，就添加一个定时器，当超时发生时，调用 WebServe::close_connection_ 方法关闭连接
-        timer_->add_timer(fd,time_out_ms_,std::bind(&WebServe::close_connection_,this,&users_[fd]));
-    }
-    //将文件描述符添加到 epoll 的监听列表中，监听可读事件和连接事件（可能是边缘触发或水平触发，取决于 connection_event_ 的值）
-    epoller_->AddFd(fd,EPOLLIN|connection_event_);
-    //将文件描述符设置为非阻塞模式 I/O 操作不会阻塞进程
-    set_fd_nonblock_(fd);
-}
-void WebServe::handle_listen_(){
-    struct sockaddr_in addr;
-    socklen_t length=sizeof(addr);
-    //如果监听套接字设置为边缘触发模式（EPOLLET），则循环将继续接受连接，直到没有更多连接可接受
-    do{
-        //调用 accept 函数接受新的连接。如果成功，返回一个新的文件描述符用于与客户端通信
-        int fd=accept(listen_fd_,(sockaddr*)&addr,&length);
-        if(fd<=0){
-            //检查 accept 是否成功
-            return;
-        }else if(HttpConnection::user_count>=max_fd_){
-            //检查当前用户数是否达到服务器允许的最大文件描述符数。如果是，则发送错误消息给客户端并关闭连接。
-            send_error_(fd,"erver busy!");
-            return;
-        }else{
-            //调用 add_client_connection_ 函数来添加新的客户端连接
-            add_client_connection_(fd,addr);
-        }
-    }while(listen_event_& EPOLLET);
-}
-void WebServe::handle_write_(HttpConnection* client) {
-    extent_time_(client);
-    m_threadpool_->submit([this, client] {
-        on_write_(client); // 协程中执行
-    });
-}
-// 处理写事件
-// 处理读事件（自动协程化）
-void WebServe::handle_read_(HttpConnection* client) {
-    assert(client);
-    extent_time_(client); // 更新连接活跃时间
-    
-    // 提交到协程线程池
-    m_threadpool_->submit([this, client] {
-        on_read_(client); // 在协程中执行
-    });
-}
-void WebServe::extent_time_(HttpConnection* client){
-    assert(client);
-    if(time_out_ms_>0){
-        timer_->update(client->get_Fd(),time_out_ms_);
-    }
-}
-void WebServe::on_read_(HttpConnection* client){
-    assert(client);
-    int ret=-1;
-    int read_error=0;
-    ret=client->read_buffer(&read_error);
-    if(ret<=0&&read_error!=EAGAIN){
-        close_connection_(client);
-        return;
-    }
-    on_process_(client);
-}
-void WebServe::on_process_(HttpConnection* client){
-    if(client->handle_httpconnection()){
-        epoller_->ModFd(client->get_Fd(),connection_event_|EPOLLOUT);
-    }else{
-        epoller_->ModFd(client->get_Fd(),connection_event_|EPOLLIN);
-    }
-}
-void WebServe::on_write_(HttpConnection* client){
-    assert(client);
-    int ret=-1;
-    int write_error=0;
-    ret=client->write_buffer(&write_error);
-    if(client->get_write_length()==0){
-        if(client->get_alive_status()){
-            on_process_(client);
-            return;
-        }
-    }else if(ret<0){
-        if(write_error==EAGAIN){
-            epoller_->ModFd(client->get_Fd(),connection_event_|EPOLLOUT);
-            return;
-        }
-    }
-    close_connection_(client);
-}
-bool WebServe::init_socket_(){
-    int ret;
-    sockaddr_in addr;
-    if(port_>65535||port_<1024){
-        return false;
-    }
-    addr.sin_family=AF_INET;
-    addr.sin_addr.s_addr=htonl(INADDR_ANY);
-    addr.sin_port=htons(port_);
-    linger opt_linger={0};
-    if(open_linger_){
-        opt_linger.l_linger=1;
-        opt_linger.l_onoff=1;
-    }
-    listen_fd_=socket(AF_INET,SOCK_STREAM,0);
-    if(listen_fd_<0){
-        return false;
-    }
-    ret=setsockopt(listen_fd_,SOL_SOCKET,SO_LINGER,&opt_linger,sizeof(opt_linger));
-    if(ret<0){
-        close(listen_fd_);
-        return false;
-    }
-    int optval=1;
-    ret=setsockopt(listen_fd_,SOL_SOCKET,SO_REUSEADDR,(const void*)&optval,sizeof(int));
-    if(ret==-1){
-        close(listen_fd_);
-        return false;
-    }
-    ret=bind(listen_fd_,(sockaddr*)&addr,sizeof(addr));
-    if(ret<0){
-        close(listen_fd_);
-        return false;
-    }
-    ret=listen(listen_fd_,6);
-    if(ret<0){
-        close(listen_fd_);
-        return false;
-    }
-    ret=epoller_->AddFd(listen_fd_,listen_event_|EPOLLIN);
-    if(ret==0){
-        close(listen_fd_);
-        return false;
-    }
-    set_fd_nonblock_(listen_fd_);
-    return true;
-}
-int WebServe::set_fd_nonblock_(int fd){
-    assert(fd>0);
-    return fcntl(fd,F_SETFL,fcntl(fd,F_GETFD,0)|O_NONBLOCK);
+void WebServe::pin_to_core_(std::thread& thread,int core){
+    unsigned int cores=std::max(1u,std::thread::hardware_concurrency());
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core%cores,&cpuset);
+    //绑定失败不影响运行，只是失去亲和性
+    pthread_setaffinity_np(thread.native_handle(),sizeof(cpu_set_t),&cpuset);
 }
 void WebServe::start(){
-    int time_ms=-1;
     if(!close_or_not_){
         std::cout<<"============================";
         std::cout<<"Server Start!";
         std::cout<<"============================";
         std::cout<<std::endl;
+    }else{
+        return;
     }
-    while(!close_or_not_){
-        if(time_out_ms_>0){
-            time_ms=timer_->get_next_timer_handle();
-        }
-        int event_cnt=epoller_->Wait(time_ms);
-        for(int i=0;i<event_cnt;++i){
-            int fd=epoller_->Get_Event_FileD(i);
-            uint32_t events=epoller_->Get_Event_events(i);
-            if(fd==listen_fd_){
-                handle_listen_();
-            }else if(events&(EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
-                assert(users_.count(fd)>0);
-                close_connection_(&users_[fd]);
-            }else if(events&EPOLLIN){
-                assert(users_.count(fd)>0);
-                handle_read_(&users_[fd]);
-            }else if(events&EPOLLOUT){
-                assert(users_.count(fd) > 0);
-                handle_write_(&users_[fd]);
-            }else{
-                std::cout<<"Unexpected event"<<std::endl;
-            }
-        }
+    if(!multi_reactor_){
+        //单Reactor模式：在主线程运行事件循环
+        reactors_[0]->loop();
+        return;
+    }
+    for(size_t i=0;i<reactors_.size();++i){
+        Reactor* reactor=reactors_[i].get();
+        reactor_threads_.emplace_back([reactor]{
+            reactor->loop();
+        });
+        pin_to_core_(reactor_threads_.back(),i);
     }
-}
\ No newline at end of file
+    for(auto& thread:reactor_threads_){
+        thread.join();
+    }
+    reactor_threads_.clear();
+}
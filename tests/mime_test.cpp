@@ -0,0 +1,72 @@
+/*
+ * @mime_test.cpp
+ * --------------
+ * 配置的 MIME 类型测试：同一后缀的不同写法（"svg" 与 ".svg"、".SVG" 与 ".svg"）。
+ *
+ * - 类型相同时合并为一项，表能生成，响应使用配置的 Content-Type
+ * - 类型不同时抛出 std::invalid_argument，错误信息指出重复的后缀（而不是项数超出容量）
+ *
+ * 用法：
+ *   make test
+ */
+#include"HttpResponse.h"
+#include"file_cache.h"
+#include"buffer.h"
+#include<cstdio>
+#include<cstdlib>
+#include<stdexcept>
+#include<string>
+#include<unistd.h>
+#include<fcntl.h>
+
+static int failures=0;
+
+static void check(bool Ok,const std::string& What){
+    printf("%-6s %s\n",Ok?"ok":"FAIL",What.c_str());
+    if(!Ok){
+        ++failures;
+    }
+}
+
+int main(){
+    size_t builtin=HttpResponse::set_Mime_Types({});
+
+    size_t size=HttpResponse::set_Mime_Types({{"svg","image/svg+xml"},{".svg","image/svg+xml"},{".SVG","image/svg+xml"}});
+    check(size==builtin+1,"same type under three spellings: "+std::to_string(size)+" entries");
+
+    char temp[]="/tmp/mime_test_XXXXXX";
+    if(!mkdtemp(temp)){
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string dir=std::string(temp)+"/";
+    int fd=open((dir+"a.svg").c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0||write(fd,"<svg/>",6)!=6){
+        perror("a.svg");
+        return 1;
+    }
+    close(fd);
+    {
+        HttpResponse response;
+        Buffer buffer;
+        response.Init(dir,"/a.svg",false,-1);
+        const std::string* header=response.make_Response(buffer);
+        check(header&&header->find("Content-Type: image/svg+xml\r\n")!=std::string::npos,"configured Content-Type served");
+    }
+    unlink((dir+"a.svg").c_str());
+    rmdir(temp);
+
+    for(const auto& types:{std::unordered_map<std::string,std::string>{{"svg","image/svg+xml"},{".svg","text/plain"}},
+                           std::unordered_map<std::string,std::string>{{".SVG","image/svg+xml"},{".svg","text/xml"}}}){
+        std::string error;
+        try{
+            HttpResponse::set_Mime_Types(types);
+        }catch(const std::invalid_argument& e){
+            error=e.what();
+        }
+        check(error.find("duplicate suffix")!=std::string::npos,"conflicting types rejected: "+error);
+    }
+    HttpResponse::set_Mime_Types({});
+    printf("%s\n",failures?"FAILED":"passed");
+    return failures?1:0;
+}
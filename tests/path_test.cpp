@@ -0,0 +1,79 @@
+/*
+ * @path_test.cpp
+ * --------------
+ * 请求路径测试：含 ".." 段的路径不能访问资源目录以外的文件。
+ *
+ * - 在临时目录中建立资源目录（index.html、404.html）与资源目录以外的 secret 文件
+ * - 分别在缓存按需加载（Init 之后）与资源目录不是缓存目录（未缓存的加载路径）两种情况下请求
+ *   "/../secret"、"/../../secret"、"/./../secret"，期望 404 与 404.html 的内容
+ * - 规范路径 "/index.html" 仍返回 200
+ *
+ * 用法：
+ *   make test
+ */
+#include"HttpResponse.h"
+#include"file_cache.h"
+#include"buffer.h"
+#include<cstdio>
+#include<cstdlib>
+#include<string>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/stat.h>
+
+static int failures=0;
+
+static void write_file(const std::string& Path,const std::string& Content){
+    int fd=open(Path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0||write(fd,Content.data(),Content.size())!=static_cast<ssize_t>(Content.size())){
+        perror(Path.c_str());
+        exit(1);
+    }
+    close(fd);
+}
+
+//请求Path，检查状态行与发送的文件内容
+static void expect(const std::string& Dir,const std::string& Path,const std::string& Status,const std::string& Body){
+    HttpResponse response;
+    Buffer buffer;
+    response.Init(Dir,Path,false,-1);
+    const std::string* header=response.make_Response(buffer);
+    std::string head=header?*header:std::string(buffer.Where_Did_We_Read(),buffer.How_Many_Bytes_We_Need_Read());
+    std::string body=response.file()?std::string(response.file(),response.file_Length()):"";
+    bool ok=head.compare(0,Status.size(),Status)==0&&body==Body;
+    printf("%-6s %-28s %s\n",ok?"ok":"FAIL",Path.c_str(),head.substr(0,head.find('\r')).c_str());
+    if(!ok){
+        ++failures;
+    }
+}
+
+int main(){
+    char temp[]="/tmp/path_test_XXXXXX";
+    if(!mkdtemp(temp)){
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string root=temp;
+    std::string resources=root+"/resources/";
+    mkdir(resources.c_str(),0755);
+    write_file(resources+"index.html","<html>index</html>\n");
+    write_file(resources+"404.html","<html>not found</html>\n");
+    write_file(root+"/secret","secret\n");
+
+    //未缓存的加载路径：资源目录不是缓存的目录
+    expect(resources,"/../secret","HTTP/1.1 404","<html>not found</html>\n");
+    //缓存的加载路径
+    FileCache::Instance().Init(resources);
+    for(const char* path:{"/../secret","/../../secret","/./../secret","/index.html/../../secret"}){
+        expect(resources,path,"HTTP/1.1 404","<html>not found</html>\n");
+    }
+    expect(resources,"/index.html","HTTP/1.1 200","<html>index</html>\n");
+
+    unlink((resources+"index.html").c_str());
+    unlink((resources+"404.html").c_str());
+    unlink((root+"/secret").c_str());
+    rmdir(resources.c_str());
+    rmdir(root.c_str());
+    printf("%s\n",failures?"FAILED":"passed");
+    return failures?1:0;
+}
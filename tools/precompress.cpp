@@ -0,0 +1,162 @@
+/*
+ * @precompress.cpp
+ * ----------------
+ * 离线预压缩工具：为资源目录下可压缩的静态文件生成同目录的 .br 与 .gz 兄弟文件，
+ * 服务器按请求的 Accept-Encoding 直接发送它们（见 FileCache 与 HttpResponse），请求时不做任何压缩。
+ *
+ * - 只处理文本类资源（html、css、js、svg、字体等），图片与已压缩的格式不处理
+ * - gzip 使用 zlib 最高级别，brotli 使用最高质量；压缩后没有明显变小（少于 5%）时不生成，并删除旧的兄弟文件
+ * - 兄弟文件不比原文件旧时跳过（-f 强制重新生成）；先写临时文件再 rename，服务器不会读到写了一半的文件
+ * - 原文件修改后兄弟文件变旧，服务器自动不再使用它，直到重新运行本工具
+ *
+ * 用法：
+ *   make tools && ./bin/precompress [-f] [资源目录] [最小字节数]
+ *   例如：cd bin && ./precompress resources 256
+ *
+ * 依赖：
+ * - zlib（-lz）、brotli 编码器（-lbrotlienc）
+ */
+#include<zlib.h>
+#include<brotli/encode.h>
+#include<sys/stat.h>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<iterator>
+#include<string>
+#include<vector>
+
+namespace fs=std::filesystem;
+
+//值得压缩的后缀
+static const char* const COMPRESSIBLE[]={".html",".htm",".css",".js",".json",".xml",".xhtml",".txt",".svg",
+                                         ".ttf",".otf",".eot",".ico",".map",".rtf"};
+
+static bool compressible(const fs::path& Path){
+    std::string ext=Path.extension().string();
+    for(const char* suffix:COMPRESSIBLE){
+        if(strcasecmp(ext.c_str(),suffix)==0){
+            return true;
+        }
+    }
+    return false;
+}
+
+//gzip格式（带文件头），失败时返回空
+static std::string gzip(const std::string& Input){
+    z_stream stream={};
+    //windowBits加16生成gzip而不是zlib格式
+    if(deflateInit2(&stream,Z_BEST_COMPRESSION,Z_DEFLATED,15+16,9,Z_DEFAULT_STRATEGY)!=Z_OK){
+        return std::string();
+    }
+    std::string output(deflateBound(&stream,Input.size()),'\0');
+    stream.next_in=reinterpret_cast<Bytef*>(const_cast<char*>(Input.data()));
+    stream.avail_in=Input.size();
+    stream.next_out=reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out=output.size();
+    int ret=deflate(&stream,Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret==Z_STREAM_END?output:std::string();
+}
+
+static std::string brotli(const std::string& Input,bool Text){
+    size_t length=BrotliEncoderMaxCompressedSize(Input.size());
+    std::string output(length,'\0');
+    if(!BrotliEncoderCompress(BROTLI_MAX_QUALITY,BROTLI_DEFAULT_WINDOW,Text?BROTLI_MODE_TEXT:BROTLI_MODE_GENERIC,
+                              Input.size(),reinterpret_cast<const uint8_t*>(Input.data()),&length,
+                              reinterpret_cast<uint8_t*>(output.data()))){
+        return std::string();
+    }
+    output.resize(length);
+    return output;
+}
+
+//兄弟文件不比原文件旧
+static bool up_to_date(const fs::path& Source,const fs::path& Sibling){
+    struct stat source,sibling;
+    if(stat(Source.c_str(),&source)<0||stat(Sibling.c_str(),&sibling)<0){
+        return false;
+    }
+    return sibling.st_mtim.tv_sec>source.st_mtim.tv_sec||
+           (sibling.st_mtim.tv_sec==source.st_mtim.tv_sec&&sibling.st_mtim.tv_nsec>=source.st_mtim.tv_nsec);
+}
+
+//写入临时文件后rename为Sibling，返回是否成功
+static bool replace(const fs::path& Sibling,const std::string& Data){
+    fs::path temp=Sibling;
+    temp+=".tmp";
+    {
+        std::ofstream out(temp,std::ios::binary|std::ios::trunc);
+        if(!out.write(Data.data(),Data.size())){
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::permissions(temp,fs::perms::owner_read|fs::perms::owner_write|fs::perms::group_read|fs::perms::others_read,error);
+    fs::rename(temp,Sibling,error);
+    return !error;
+}
+
+int main(int argc,char* argv[]){
+    bool force=false;
+    int arg=1;
+    if(arg<argc&&strcmp(argv[arg],"-f")==0){
+        force=true;
+        ++arg;
+    }
+    fs::path root=arg<argc?argv[arg++]:"resources";
+    size_t min_size=arg<argc?strtoull(argv[arg++],nullptr,10):256;
+    std::error_code error;
+    if(!fs::is_directory(root,error)){
+        fprintf(stderr,"usage: %s [-f] [resource dir] [min bytes]\n",argv[0]);
+        return 1;
+    }
+
+    size_t files=0,original_bytes=0,gzip_bytes=0,brotli_bytes=0;
+    for(auto it=fs::recursive_directory_iterator(root,error);it!=fs::recursive_directory_iterator();it.increment(error)){
+        if(error){
+            break;
+        }
+        const fs::path& path=it->path();
+        if(!it->is_regular_file(error)||!compressible(path)||it->file_size(error)<min_size){
+            continue;
+        }
+        std::ifstream in(path,std::ios::binary);
+        std::string input((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+        bool text=path.extension()!=".ttf"&&path.extension()!=".otf"&&path.extension()!=".eot"&&path.extension()!=".ico";
+        struct Variant{
+            const char* Suffix;
+            size_t* Total;
+        };
+        for(Variant variant:{Variant{".gz",&gzip_bytes},Variant{".br",&brotli_bytes}}){
+            fs::path sibling=path;
+            sibling+=variant.Suffix;
+            if(!force&&up_to_date(path,sibling)){
+                *variant.Total+=fs::file_size(sibling,error);
+                continue;
+            }
+            std::string output=variant.Suffix[1]=='g'?gzip(input):brotli(input,text);
+            if(output.empty()||output.size()>=input.size()-input.size()/20){
+                //压缩效果不明显：不生成，旧的兄弟文件也删除，服务器发送原文件
+                fs::remove(sibling,error);
+                *variant.Total+=input.size();
+                continue;
+            }
+            if(!replace(sibling,output)){
+                fprintf(stderr,"cannot write %s\n",sibling.c_str());
+                return 1;
+            }
+            *variant.Total+=output.size();
+            printf("%-48s %9zu -> %9zu %s\n",path.c_str(),input.size(),output.size(),variant.Suffix);
+        }
+        ++files;
+        original_bytes+=input.size();
+    }
+    printf("%zu files, %zu bytes: gzip %zu (%.1f%%), brotli %zu (%.1f%%)\n",files,original_bytes,
+           gzip_bytes,original_bytes?100.0*gzip_bytes/original_bytes:0.0,
+           brotli_bytes,original_bytes?100.0*brotli_bytes/original_bytes:0.0);
+    return 0;
+}